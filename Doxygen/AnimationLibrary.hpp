@@ -0,0 +1,231 @@
+#ifndef AnimationLibrary_hpp
+#define AnimationLibrary_hpp
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#elif defined(__APPLE__)
+    #include <SDL2/SDL.h>
+#else
+    #include <SDL.h>
+#endif
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AssetTable.hpp"
+#include "CookedScene.hpp"
+
+/**
+ * @enum AnimationModel
+ * @brief animation model
+ */
+enum AnimationModel
+{
+    single,///play the animation once
+    loop///play the animation
+};
+
+/**
+ * @brief Id of a clip in the animation library.
+ */
+typedef uint32_t AnimationClipId;
+
+/**
+ * @brief Id of no clip.
+ */
+const AnimationClipId kInvalidClip = 0xFFFFFFFFu;
+
+/**
+ * @struct AnimationClip
+ * @brief One animation, shared by every animator playing it and never changed after it is added.
+ */
+struct AnimationClip
+{
+    std::string name;///< Name of the animation in its file.
+    SDL_Texture* texture = nullptr;///< Sprite sheet the frames are cut from.
+    AssetHandle<SDL_Texture> textureHandle;///< Hold on the sprite sheet, released when the library drops the clip.
+    std::vector<SDL_Rect> frames;///< Source rect of each frame, in playing order.
+    int fps = 12;///< Frames per second.
+    AnimationModel model = loop;///< How the clip plays unless the animator asks otherwise.
+};
+
+/**
+ * @struct AnimationSet
+ * @brief The clips of one animation file.
+ */
+struct AnimationSet
+{
+    std::string path;///< Animation file, or cooked set name, the clips come from.
+    std::vector<AnimationClipId> clips;///< Clips of the set.
+};
+
+/**
+ * @class AnimationLibrary
+ * @brief Every animation file parsed once into immutable clips addressed by integer ids.
+ * @details Sets and clips are never moved once added, so animators keep plain pointers to them. The library only
+ * stores what it is given: ResourceManager::LoadAnimations parses the json, AddCookedSet reads a cooked scene.
+ * Each clip holds its sprite sheet through textureHandle, acquired by whoever built the clip, so EvictUnusedAssets
+ * cannot free a sheet that is still played. Clear hands every handle back; ResourceManager::ClearAnimations does it
+ * with ReleaseTexture.
+ */
+class AnimationLibrary
+{
+public:
+    /**
+     * \brief Add an empty set for a file, or get the one already added
+     * @param path animation file
+     * @return the set
+     */
+    AnimationSet* AddSet(std::string const& path)
+    {
+        std::unordered_map<std::string, AnimationSet*>::iterator it = m_setsByPath.find(path);
+        if(it != m_setsByPath.end())
+        {
+            return it->second;
+        }
+        m_sets.push_back(AnimationSet());
+        AnimationSet* set = &m_sets.back();
+        set->path = path;
+        m_setsByPath[path] = set;
+        return set;
+    }
+
+    /**
+     * \brief Add a clip to a set
+     * @param set set from AddSet
+     * @param clip the clip, moved into the library
+     * @return id of the clip
+     */
+    AnimationClipId AddClip(AnimationSet* set, AnimationClip clip)
+    {
+        AnimationClipId id = static_cast<AnimationClipId>(m_clips.size());
+        m_clips.push_back(std::move(clip));
+        set->clips.push_back(id);
+        return id;
+    }
+
+    /**
+     * \brief Add the clips of a cooked animation set, once
+     * Frames are numbered row by row on the sprite sheet.
+     * @param scene open cooked scene
+     * @param cooked set of the scene
+     * @param texture sprite sheet of the set
+     * @param handle hold on the sprite sheet, acquired once for each clip of the set when the set is added
+     * @param acquire called with handle for each clip added, so every clip holds the sheet
+     * @return the set
+     */
+    template <typename Acquire>
+    AnimationSet const* AddCookedSet(CookedScene const& scene, CookedAnimationSet const& cooked, SDL_Texture* texture,
+                                     AssetHandle<SDL_Texture> handle, Acquire acquire)
+    {
+        std::string path = scene.GetString(cooked.name);
+        AnimationSet const* existing = FindSet(path);
+        if(existing)
+        {
+            return existing;
+        }
+        AnimationSet* set = AddSet(path);
+        const CookedClip* clips = scene.GetClips(cooked);
+        int columns = cooked.sheetCol > 0 ? cooked.sheetCol : 1;
+        for(uint32_t i = 0; i < cooked.clipCount; ++i)
+        {
+            AnimationClip clip;
+            clip.name = scene.GetString(clips[i].name);
+            clip.texture = texture;
+            clip.textureHandle = handle;
+            clip.fps = clips[i].fps > 0 ? clips[i].fps : clip.fps;
+            for(int frame = clips[i].startFrame; frame <= clips[i].lastFrame; ++frame)
+            {
+                clip.frames.push_back(SDL_Rect{(frame % columns) * cooked.spriteWidth, (frame / columns) * cooked.spriteHeight,
+                                               cooked.spriteWidth, cooked.spriteHeight});
+            }
+            if(handle.IsValid())
+            {
+                acquire(handle);
+            }
+            AddClip(set, std::move(clip));
+        }
+        return set;
+    }
+
+    /**
+     * \brief Get the set of a file
+     * @param path animation file
+     * @return the set, nullptr if the file was never added
+     */
+    AnimationSet const* FindSet(std::string const& path) const
+    {
+        std::unordered_map<std::string, AnimationSet*>::const_iterator it = m_setsByPath.find(path);
+        return it == m_setsByPath.end() ? nullptr : it->second;
+    }
+
+    /**
+     * \brief Get a clip
+     * @param id id of the clip
+     * @return the clip, nullptr for kInvalidClip or an unknown id
+     */
+    AnimationClip const* GetClip(AnimationClipId id) const
+    {
+        return id < m_clips.size() ? &m_clips[id] : nullptr;
+    }
+
+    /**
+     * \brief Find a clip of a set by name, sets hold few clips so the search is linear
+     * @param set set to search
+     * @param name name of the animation
+     * @return id of the clip, kInvalidClip if the set has no such animation
+     */
+    AnimationClipId FindClip(AnimationSet const* set, std::string const& name) const
+    {
+        if(!set)
+        {
+            return kInvalidClip;
+        }
+        for(AnimationClipId id : set->clips)
+        {
+            if(m_clips[id].name == name)
+            {
+                return id;
+            }
+        }
+        return kInvalidClip;
+    }
+
+    /**
+     * \brief Number of clips in the library
+     */
+    size_t GetClipCount() const
+    {
+        return m_clips.size();
+    }
+
+    /**
+     * \brief Remove every set and clip, animators must not use them anymore
+     * @param release called with the textureHandle of every clip that has one, to stop holding its sprite sheet
+     */
+    template <typename Release>
+    void Clear(Release release)
+    {
+        for(AnimationClip const& clip : m_clips)
+        {
+            if(clip.textureHandle.IsValid())
+            {
+                release(clip.textureHandle);
+            }
+        }
+        m_setsByPath.clear();
+        m_sets.clear();
+        m_clips.clear();
+    }
+
+private:
+    std::deque<AnimationSet> m_sets;///< All sets, a deque so they never move.
+    std::deque<AnimationClip> m_clips;///< All clips by id, a deque so they never move.
+    std::unordered_map<std::string, AnimationSet*> m_setsByPath;///< Sets by file.
+};
+
+#endif /* AnimationLibrary_hpp */
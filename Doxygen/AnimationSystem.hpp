@@ -0,0 +1,347 @@
+#ifndef AnimationSystem_hpp
+#define AnimationSystem_hpp
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#elif defined(__APPLE__)
+    #include <SDL2/SDL.h>
+#else
+    #include <SDL.h>
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "AnimationLibrary.hpp"
+#include "RenderQueue.hpp"
+#include "Vector2Batch.hpp"
+#include "Profiler.hpp"
+
+/**
+ * \brief Frame of a clip after some playing time, a pure function so any animation can be sampled at any time
+ * @param clip clip being played
+ * @param elapsedMs playing time in milliseconds, already scaled by the playing speed
+ * @param model loop wraps around, single stays on the last frame
+ * @return index in clip.frames, 0 for a clip without frames
+ */
+inline int SampleClipFrame(AnimationClip const& clip, double elapsedMs, AnimationModel model)
+{
+    int count = static_cast<int>(clip.frames.size());
+    if(count == 0 || elapsedMs <= 0.0)
+    {
+        return 0;
+    }
+    int64_t frame = static_cast<int64_t>(elapsedMs * clip.fps / 1000.0);
+    if(model == loop)
+    {
+        return static_cast<int>(frame % count);
+    }
+    return frame < count ? static_cast<int>(frame) : count - 1;
+}
+
+/**
+ * @class AnimationSystem
+ * @brief Animated sprites without game objects, stored as flat arrays and sampled in a single pass.
+ * @details An instance is only a clip, a start time, a speed and a mode; nothing is advanced per frame. Its current
+ * frame is computed from the animation clock when it is submitted for rendering, after the culling test, so
+ * instances outside the camera cost one bounds check. The bounds are also kept as float arrays, so the culling
+ * test of all instances is one OverlapAabbBatch pass. Meant for large numbers of decorative sprites; use an
+ * Animator when a game object needs one.
+ */
+class AnimationSystem
+{
+public:
+    typedef uint32_t InstanceId;
+    static const InstanceId kInvalidInstance = 0xFFFFFFFFu;///< Id of no instance.
+
+    /**
+     * \brief Time of the animation clock in milliseconds, advanced by the engine with the frame delta time
+     */
+    static uint32_t GetTime()
+    {
+        return Clock().load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Move the animation clock forward
+     * @param dt milliseconds
+     */
+    static void AdvanceTime(uint32_t dt)
+    {
+        Clock().fetch_add(dt, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Add an animated sprite
+     * @param clip clip to play
+     * @param dst where to draw it, in the units of the render queue it is submitted to
+     * @param layer sorting layer
+     * @param speed playing speed, 1 for the fps of the clip
+     * @param model loop or play once
+     * @return id of the instance
+     */
+    InstanceId Add(AnimationClipId clip, SDL_Rect const& dst, int layer = 0, float speed = 1.0f,
+                   AnimationModel model = loop)
+    {
+        InstanceId id;
+        if(!m_freeIds.empty())
+        {
+            id = m_freeIds.back();
+            m_freeIds.pop_back();
+        }
+        else
+        {
+            id = static_cast<InstanceId>(m_slots.size());
+            m_slots.push_back(0);
+        }
+        m_slots[id] = static_cast<uint32_t>(m_ids.size());
+        m_ids.push_back(id);
+        m_clips.push_back(clip);
+        m_starts.push_back(GetTime());
+        m_offsets.push_back(0.0);
+        m_speeds.push_back(speed);
+        m_models.push_back(static_cast<uint8_t>(model));
+        m_dsts.push_back(dst);
+        m_layers.push_back(layer);
+        m_minX.push_back(0.0f);
+        m_minY.push_back(0.0f);
+        m_maxX.push_back(0.0f);
+        m_maxY.push_back(0.0f);
+        SetBounds(m_ids.size() - 1, dst);
+        return id;
+    }
+
+    /**
+     * \brief Whether an id refers to an instance that was added and not removed
+     * @param id id of the instance
+     */
+    bool Contains(InstanceId id) const
+    {
+        return id < m_slots.size() && m_slots[id] != kInvalidInstance;
+    }
+
+    /**
+     * \brief Remove an animated sprite, its id may be given to a later one
+     * @param id id of the instance
+     * @return false if the id is not an instance, removed already for example
+     */
+    bool Remove(InstanceId id)
+    {
+        if(!Contains(id))
+        {
+            return false;
+        }
+        uint32_t index = m_slots[id];
+        uint32_t last = static_cast<uint32_t>(m_ids.size() - 1);
+        if(index != last)
+        {
+            m_ids[index] = m_ids[last];
+            m_clips[index] = m_clips[last];
+            m_starts[index] = m_starts[last];
+            m_offsets[index] = m_offsets[last];
+            m_speeds[index] = m_speeds[last];
+            m_models[index] = m_models[last];
+            m_dsts[index] = m_dsts[last];
+            m_layers[index] = m_layers[last];
+            m_minX[index] = m_minX[last];
+            m_minY[index] = m_minY[last];
+            m_maxX[index] = m_maxX[last];
+            m_maxY[index] = m_maxY[last];
+            m_slots[m_ids[index]] = index;
+        }
+        m_ids.pop_back();
+        m_clips.pop_back();
+        m_starts.pop_back();
+        m_offsets.pop_back();
+        m_speeds.pop_back();
+        m_models.pop_back();
+        m_dsts.pop_back();
+        m_layers.pop_back();
+        m_minX.pop_back();
+        m_minY.pop_back();
+        m_maxX.pop_back();
+        m_maxY.pop_back();
+        m_slots[id] = kInvalidInstance;
+        m_freeIds.push_back(id);
+        return true;
+    }
+
+    /**
+     * \brief Start another clip, from its first frame
+     * @param id id of the instance
+     * @param clip clip to play
+     * @param model loop or play once
+     * @return false if the id is not an instance
+     */
+    bool Play(InstanceId id, AnimationClipId clip, AnimationModel model)
+    {
+        if(!Contains(id))
+        {
+            return false;
+        }
+        uint32_t index = m_slots[id];
+        m_clips[index] = clip;
+        m_models[index] = static_cast<uint8_t>(model);
+        m_starts[index] = GetTime();
+        m_offsets[index] = 0.0;
+        return true;
+    }
+
+    /**
+     * \brief Change the playing speed without jumping to another frame
+     * @param id id of the instance
+     * @param speed new speed, 0 to hold the current frame
+     * @return false if the id is not an instance
+     */
+    bool SetSpeed(InstanceId id, float speed)
+    {
+        if(!Contains(id))
+        {
+            return false;
+        }
+        uint32_t index = m_slots[id];
+        uint32_t now = GetTime();
+        m_offsets[index] = Elapsed(index, now);
+        m_starts[index] = now;
+        m_speeds[index] = speed;
+        return true;
+    }
+
+    /**
+     * \brief Move an animated sprite
+     * @param id id of the instance
+     * @param dst where to draw it
+     * @return false if the id is not an instance
+     */
+    bool SetDestination(InstanceId id, SDL_Rect const& dst)
+    {
+        if(!Contains(id))
+        {
+            return false;
+        }
+        m_dsts[m_slots[id]] = dst;
+        SetBounds(m_slots[id], dst);
+        return true;
+    }
+
+    /**
+     * \brief Get the frame an instance shows at a time
+     * @param id id of the instance
+     * @param library library holding its clip
+     * @param time time of the animation clock
+     * @return index in the frames of its clip, -1 if the id is not an instance
+     */
+    int GetFrame(InstanceId id, AnimationLibrary const& library, uint32_t time) const
+    {
+        if(!Contains(id))
+        {
+            return -1;
+        }
+        uint32_t index = m_slots[id];
+        AnimationClip const* clip = library.GetClip(m_clips[index]);
+        return clip ? SampleClipFrame(*clip, Elapsed(index, time), static_cast<AnimationModel>(m_models[index])) : 0;
+    }
+
+    /**
+     * \brief Submit every visible instance with the frame it shows at a time
+     * @param queue render queue, whose view decides what is visible
+     * @param library library holding the clips
+     * @param time time of the animation clock
+     * @return number of instances sampled
+     */
+    int Submit(RenderQueue& queue, AnimationLibrary const& library, uint32_t time) const
+    {
+        PROFILE_SCOPE("AnimationSystem");
+        SDL_Rect const* bounds = queue.GetViewBounds();
+        if(bounds)
+        {
+            // The queue keeps rects that overlap the view strictly. Edges are integers, so left < viewRight is
+            // left <= viewRight - 1 and right > viewLeft is right >= viewLeft + 1, the inclusive test of the kernel.
+            m_visible.resize(m_ids.size());
+            OverlapAabbBatch(m_minX.data(), m_minY.data(), m_maxX.data(), m_maxY.data(), m_ids.size(),
+                             static_cast<float>(bounds->x + 1), static_cast<float>(bounds->y + 1),
+                             static_cast<float>(bounds->x + bounds->w - 1), static_cast<float>(bounds->y + bounds->h - 1),
+                             m_visible.data());
+        }
+        int sampled = 0;
+        AnimationClipId lastId = kInvalidClip;
+        AnimationClip const* clip = nullptr;
+        SpriteCommand command;
+        for(size_t i = 0; i < m_ids.size(); ++i)
+        {
+            if(bounds && !m_visible[i])
+            {
+                continue;
+            }
+            if(m_clips[i] != lastId)
+            {
+                lastId = m_clips[i];
+                clip = library.GetClip(lastId);
+            }
+            if(!clip || clip->frames.empty())
+            {
+                continue;
+            }
+            command.texture = clip->texture;
+            command.src = clip->frames[SampleClipFrame(*clip, Elapsed(i, time), static_cast<AnimationModel>(m_models[i]))];
+            command.dst = m_dsts[i];
+            command.layer = m_layers[i];
+            queue.Submit(command);
+            ++sampled;
+        }
+        return sampled;
+    }
+
+    /**
+     * \brief Number of instances
+     */
+    size_t Size() const
+    {
+        return m_ids.size();
+    }
+
+private:
+    static std::atomic<uint32_t>& Clock()
+    {
+        static std::atomic<uint32_t> clock{0};
+        return clock;
+    }
+
+    /**
+     * \brief Store the culling bounds of the instance at a packed index, min is the rect origin and max its far edge
+     */
+    void SetBounds(size_t index, SDL_Rect const& dst)
+    {
+        m_minX[index] = static_cast<float>(dst.x);
+        m_minY[index] = static_cast<float>(dst.y);
+        m_maxX[index] = static_cast<float>(dst.x + dst.w);
+        m_maxY[index] = static_cast<float>(dst.y + dst.h);
+    }
+
+    /**
+     * \brief Playing time of the instance at a packed index, in milliseconds of the clip
+     */
+    double Elapsed(size_t index, uint32_t time) const
+    {
+        return m_offsets[index] + static_cast<double>(time - m_starts[index]) * m_speeds[index];
+    }
+
+    std::vector<InstanceId> m_ids;///< Id of each packed instance.
+    std::vector<AnimationClipId> m_clips;///< Clip of each packed instance.
+    std::vector<uint32_t> m_starts;///< Clock time each packed instance started its clip or last changed speed.
+    std::vector<double> m_offsets;///< Playing time of each packed instance at its start time, in milliseconds.
+    std::vector<float> m_speeds;///< Playing speed of each packed instance.
+    std::vector<uint8_t> m_models;///< AnimationModel of each packed instance.
+    std::vector<SDL_Rect> m_dsts;///< Destination of each packed instance.
+    std::vector<int> m_layers;///< Sorting layer of each packed instance.
+    std::vector<float> m_minX;///< Left edge of each packed instance, for the culling kernel.
+    std::vector<float> m_minY;///< Top edge of each packed instance.
+    std::vector<float> m_maxX;///< Right edge of each packed instance.
+    std::vector<float> m_maxY;///< Bottom edge of each packed instance.
+    mutable std::vector<uint8_t> m_visible;///< Culling result of each packed instance, reused by Submit.
+    std::vector<uint32_t> m_slots;///< Id to packed index, kInvalidInstance when free.
+    std::vector<InstanceId> m_freeIds;///< Ids of removed instances.
+};
+
+#endif /* AnimationSystem_hpp */
@@ -0,0 +1,284 @@
+#ifndef AssetTable_hpp
+#define AssetTable_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @struct AssetHandle
+ * @brief Compact reference to an interned asset of type T.
+ * @details A handle keeps pointing at the same path for the whole run, even after its resource is evicted.
+ */
+template <typename T>
+struct AssetHandle
+{
+    uint32_t index = 0xFFFFFFFFu;///< Index in the asset table.
+
+    /**
+     * \brief Whether the handle refers to an interned path
+     */
+    bool IsValid() const
+    {
+        return index != 0xFFFFFFFFu;
+    }
+
+    bool operator==(AssetHandle const& rhs) const
+    {
+        return index == rhs.index;
+    }
+
+    bool operator!=(AssetHandle const& rhs) const
+    {
+        return index != rhs.index;
+    }
+};
+
+/**
+ * @class AssetTable
+ * @brief Interns asset paths into handles backed by fixed blocks of entries.
+ * @details The path is hashed only when it is interned. After that Get() is two indexations and an atomic load,
+ * without a lock, so the update thread can look resources up while the render thread loads and frees them.
+ * Entries are allocated in blocks that never move, so interning does not invalidate the entries being read.
+ * Intern and Find touch the path map and must not run concurrently with each other; the owner serializes them.
+ * Every asset counts how many users acquired it, and EvictUnused() frees the ones that were acquired and that
+ * nobody holds anymore. An asset that was never acquired may still be used through a raw pointer, so it is kept.
+ */
+template <typename T>
+class AssetTable
+{
+public:
+    typedef AssetHandle<T> Handle;
+
+    static const uint32_t kBlockBits = 10;///< log2 of the entries of a block.
+    static const uint32_t kBlockSize = 1u << kBlockBits;///< Entries of a block.
+    static const uint32_t kMaxBlocks = 4096;///< Blocks of a table, so at most kBlockSize * kMaxBlocks assets.
+
+    AssetTable()
+    {
+        for(uint32_t i = 0; i < kMaxBlocks; ++i)
+        {
+            m_blocks[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    AssetTable(AssetTable const&) = delete;
+    AssetTable& operator=(AssetTable const&) = delete;
+
+    ~AssetTable()
+    {
+        for(uint32_t i = 0; i < kMaxBlocks; ++i)
+        {
+            delete m_blocks[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * \brief Get the handle of a path, interning it if it is new
+     * @param path path of the asset
+     * @return handle of the path, invalid if the table is full
+     */
+    Handle Intern(std::string const& path)
+    {
+        Handle handle = Find(path);
+        if(handle.IsValid())
+        {
+            return handle;
+        }
+        uint32_t index = m_size.load(std::memory_order_relaxed);
+        uint32_t block = index >> kBlockBits;
+        if(block >= kMaxBlocks)
+        {
+            return handle;
+        }
+        if(!m_blocks[block].load(std::memory_order_relaxed))
+        {
+            m_blocks[block].store(new Block(), std::memory_order_release);
+        }
+        EntryAt(index).path = path;
+        m_indices.emplace(path, index);
+        m_size.store(index + 1, std::memory_order_release);
+        handle.index = index;
+        return handle;
+    }
+
+    /**
+     * \brief Get the handle of a path without interning it
+     * @param path path of the asset
+     * @return handle of the path, invalid if it was never interned
+     */
+    Handle Find(std::string const& path) const
+    {
+        Handle handle;
+        std::unordered_map<std::string, uint32_t>::const_iterator it = m_indices.find(path);
+        if(it != m_indices.end())
+        {
+            handle.index = it->second;
+        }
+        return handle;
+    }
+
+    /**
+     * \brief Get the resource of a handle, from any thread
+     * @param handle handle of the asset
+     * @return resource, nullptr if the handle is invalid or the asset is not loaded
+     */
+    T* Get(Handle handle) const
+    {
+        return Contains(handle) ? EntryAt(handle.index).resource.load(std::memory_order_acquire) : nullptr;
+    }
+
+    /**
+     * \brief Set the resource of a handle
+     * @param handle handle of the asset
+     * @param resource loaded resource
+     */
+    void Set(Handle handle, T* resource)
+    {
+        if(Contains(handle))
+        {
+            EntryAt(handle.index).resource.store(resource, std::memory_order_release);
+        }
+    }
+
+    /**
+     * \brief Get the path of a handle
+     * @param handle handle of the asset
+     */
+    std::string const& GetPath(Handle handle) const
+    {
+        return EntryAt(handle.index).path;
+    }
+
+    /**
+     * \brief Add a user to an asset, from any thread
+     * Call it before Get: an eviction running at the same time then either keeps the resource or was already
+     * done, and Get returns nullptr until the asset is loaded again.
+     * @param handle handle of the asset
+     */
+    void AddRef(Handle handle)
+    {
+        if(Contains(handle))
+        {
+            Entry& entry = EntryAt(handle.index);
+            entry.refCount.fetch_add(1);
+            entry.acquired.store(true);
+        }
+    }
+
+    /**
+     * \brief Remove a user from an asset, from any thread. The resource is kept until EvictUnused is called.
+     * @param handle handle of the asset
+     */
+    void Release(Handle handle)
+    {
+        if(!Contains(handle))
+        {
+            return;
+        }
+        std::atomic<int>& refCount = EntryAt(handle.index).refCount;
+        int count = refCount.load();
+        while(count > 0 && !refCount.compare_exchange_weak(count, count - 1))
+        {
+        }
+    }
+
+    /**
+     * \brief Get how many users hold an asset
+     * @param handle handle of the asset
+     */
+    int GetRefCount(Handle handle) const
+    {
+        return Contains(handle) ? EntryAt(handle.index).refCount.load() : 0;
+    }
+
+    /**
+     * \brief Free every loaded resource that was acquired and has no users anymore
+     * Resources never acquired are kept. The handles of freed ones stay valid and can be reloaded.
+     * The resource is taken out of its entry before the users are counted again, so a user acquiring it meanwhile
+     * either makes the eviction put it back or never got it from Get.
+     * @param free function that frees one resource, e.g. SDL_DestroyTexture
+     * @return number of resources freed
+     */
+    template <typename Free>
+    int EvictUnused(Free free)
+    {
+        int evicted = 0;
+        uint32_t size = m_size.load(std::memory_order_acquire);
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            Entry& entry = EntryAt(i);
+            if(!entry.acquired.load() || entry.refCount.load() != 0 || !entry.resource.load())
+            {
+                continue;
+            }
+            T* resource = entry.resource.exchange(nullptr);
+            if(entry.refCount.load() != 0)
+            {
+                entry.resource.store(resource);
+                continue;
+            }
+            entry.acquired.store(false);
+            free(resource);
+            ++evicted;
+        }
+        return evicted;
+    }
+
+    /**
+     * \brief Free every loaded resource, used or not
+     * @param free function that frees one resource
+     */
+    template <typename Free>
+    void Clear(Free free)
+    {
+        uint32_t size = m_size.load(std::memory_order_acquire);
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            if(T* resource = EntryAt(i).resource.exchange(nullptr))
+            {
+                free(resource);
+            }
+        }
+    }
+
+private:
+    /**
+     * @struct Entry
+     * @brief One interned asset
+     */
+    struct Entry
+    {
+        std::atomic<T*> resource{nullptr};///< Loaded resource, nullptr if not loaded.
+        std::atomic<int> refCount{0};///< Number of users holding the asset.
+        std::atomic<bool> acquired{false};///< Whether the loaded resource was ever held, so only its holders use it.
+        std::string path;///< Interned path, written before the entry is published.
+    };
+
+    /**
+     * @struct Block
+     * @brief kBlockSize entries, never moved once allocated
+     */
+    struct Block
+    {
+        Entry entries[kBlockSize];
+    };
+
+    bool Contains(Handle handle) const
+    {
+        return handle.index < m_size.load(std::memory_order_acquire);
+    }
+
+    Entry& EntryAt(uint32_t index) const
+    {
+        return m_blocks[index >> kBlockBits].load(std::memory_order_acquire)->entries[index & (kBlockSize - 1)];
+    }
+
+    std::atomic<Block*> m_blocks[kMaxBlocks];///< Blocks of entries, allocated as handles are interned.
+    std::atomic<uint32_t> m_size{0};///< Interned assets; entries below it are published.
+    std::unordered_map<std::string, uint32_t> m_indices;///< Path to handle index.
+};
+
+#endif /* AssetTable_hpp */
@@ -0,0 +1,285 @@
+#ifndef AsyncLoader_hpp
+#define AsyncLoader_hpp
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+    #include <SDL2/SDL_image.h>
+    #include <SDL2/SDL_mixer.h>
+#elif defined(__APPLE__)
+    #include <SDL2/SDL.h>
+    #include <SDL2_image/SDL_image.h>
+    #include <SDL2_mixer/SDL_mixer.h>
+#else
+    #include <SDL.h>
+    #include <SDL_image.h>
+    #include <SDL_mixer.h>
+#endif
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class AsyncLoader
+ * @brief Decodes pictures and sounds on worker threads and finishes them on the main thread.
+ * @details Workers only run IMG_Load and Mix_LoadWAV. Textures must be created on the thread that owns the
+ * renderer, so decoded surfaces wait in a queue until Pump() uploads them, at most for the given time per call.
+ * Futures are fulfilled by Pump(), so a result is never seen before the resource manager has stored it.
+ */
+class AsyncLoader
+{
+public:
+    /**
+     * \brief Called on the main thread when a texture is ready
+     */
+    typedef std::function<void(std::string const& path, SDL_Texture* texture)> TextureCallback;
+    /**
+     * \brief Called on the main thread when a sound is ready
+     */
+    typedef std::function<void(std::string const& path, Mix_Chunk* chunk)> ChunkCallback;
+
+    /**
+     * \brief Constructor, starts the workers
+     * @param workerCount number of decoding threads
+     */
+    explicit AsyncLoader(int workerCount = 2)
+    {
+        for(int i = 0; i < workerCount; ++i)
+        {
+            m_workers.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+
+    /**
+     * \brief Destructor, drops queued work and waits for the workers to finish their current job
+     */
+    ~AsyncLoader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            m_quit = true;
+            m_jobs.clear();
+        }
+        m_jobCondition.notify_all();
+        for(std::thread& worker : m_workers)
+        {
+            worker.join();
+        }
+        for(Decoded& decoded : m_decoded)
+        {
+            if(decoded.surface)
+            {
+                SDL_FreeSurface(decoded.surface);
+            }
+            if(decoded.chunk)
+            {
+                Mix_FreeChunk(decoded.chunk);
+            }
+        }
+    }
+
+    /**
+     * \brief Decode a picture in the background
+     * @param path path of the picture
+     * @param onReady called from Pump() once the texture exists, nullptr on failure
+     * @return future of the texture, nullptr on failure
+     */
+    std::shared_future<SDL_Texture*> LoadTexture(std::string const& path, TextureCallback onReady)
+    {
+        std::shared_ptr<std::promise<SDL_Texture*>> promise = std::make_shared<std::promise<SDL_Texture*>>();
+        std::shared_future<SDL_Texture*> future = promise->get_future().share();
+        Enqueue([this, path, onReady, promise]()
+                {
+                    Decoded decoded;
+                    decoded.path = path;
+                    decoded.surface = IMG_Load(path.c_str());
+                    decoded.finish = [onReady, promise](std::string const& p, SDL_Renderer* renderer, SDL_Surface* surface)
+                    {
+                        SDL_Texture* texture = nullptr;
+                        if(surface)
+                        {
+                            texture = SDL_CreateTextureFromSurface(renderer, surface);
+                            SDL_FreeSurface(surface);
+                        }
+                        if(onReady)
+                        {
+                            onReady(p, texture);
+                        }
+                        promise->set_value(texture);
+                    };
+                    decoded.upload = true;
+                    PushDecoded(std::move(decoded));
+                    return true;
+                });
+        return future;
+    }
+
+    /**
+     * \brief Decode a sound in the background
+     * @param path path of the sound
+     * @param onReady called from Pump() with the chunk, nullptr on failure
+     * @return future of the chunk, nullptr on failure
+     */
+    std::shared_future<Mix_Chunk*> LoadChunk(std::string const& path, ChunkCallback onReady)
+    {
+        std::shared_ptr<std::promise<Mix_Chunk*>> promise = std::make_shared<std::promise<Mix_Chunk*>>();
+        std::shared_future<Mix_Chunk*> future = promise->get_future().share();
+        Enqueue([this, path, onReady, promise]()
+                {
+                    Mix_Chunk* chunk = Mix_LoadWAV(path.c_str());
+                    Decoded decoded;
+                    decoded.path = path;
+                    decoded.chunk = chunk;
+                    decoded.finish = [onReady, promise, chunk](std::string const& p, SDL_Renderer*, SDL_Surface*)
+                    {
+                        if(onReady)
+                        {
+                            onReady(p, chunk);
+                        }
+                        promise->set_value(chunk);
+                    };
+                    PushDecoded(std::move(decoded));
+                    return true;
+                });
+        return future;
+    }
+
+    /**
+     * \brief Run any job on a worker thread
+     * The job must not touch the renderer or state owned by the main thread.
+     * @param job work to run
+     */
+    void Submit(std::function<void()> job)
+    {
+        Enqueue([job]()
+                {
+                    job();
+                    return false;
+                });
+    }
+
+    /**
+     * \brief Finish decoded assets on the main thread
+     * Sounds are cheap to finish and are not counted against the budget, texture uploads are.
+     * At least one texture is uploaded per call so loading always makes progress.
+     * @param renderer renderer that owns the textures
+     * @param budgetMs time allowed for texture uploads in this call
+     * @return number of assets finished
+     */
+    int Pump(SDL_Renderer* renderer, Uint32 budgetMs)
+    {
+        Uint32 start = SDL_GetTicks();
+        int finished = 0;
+        bool uploaded = false;
+        while(true)
+        {
+            Decoded decoded;
+            {
+                std::lock_guard<std::mutex> lock(m_decodedMutex);
+                if(m_decoded.empty())
+                {
+                    break;
+                }
+                if(m_decoded.front().upload && uploaded && SDL_GetTicks() - start >= budgetMs)
+                {
+                    break;
+                }
+                decoded = std::move(m_decoded.front());
+                m_decoded.pop_front();
+            }
+            uploaded = uploaded || decoded.upload;
+            decoded.finish(decoded.path, renderer, decoded.surface);
+            ++finished;
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            --m_pending;
+        }
+        return finished;
+    }
+
+    /**
+     * \brief Number of assets that are queued, decoding or waiting for Pump()
+     * Jobs given to Submit() count until they have run.
+     */
+    int GetPendingCount()
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        return m_pending;
+    }
+
+private:
+    /**
+     * @struct Decoded
+     * @brief An asset whose background work is done
+     */
+    struct Decoded
+    {
+        std::string path;///< Path of the asset.
+        SDL_Surface* surface = nullptr;///< Decoded picture, nullptr for sounds.
+        Mix_Chunk* chunk = nullptr;///< Decoded sound, freed if the loader dies before Pump() hands it over.
+        bool upload = false;///< Whether finishing it creates a texture.
+        std::function<void(std::string const&, SDL_Renderer*, SDL_Surface*)> finish;///< Main thread part.
+    };
+
+    /**
+     * \brief Queue work for the workers
+     * @param job returns true if it queued a Decoded that Pump() still has to finish
+     */
+    void Enqueue(std::function<bool()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            m_jobs.push_back(std::move(job));
+            ++m_pending;
+        }
+        m_jobCondition.notify_one();
+    }
+
+    void PushDecoded(Decoded decoded)
+    {
+        std::lock_guard<std::mutex> lock(m_decodedMutex);
+        m_decoded.push_back(std::move(decoded));
+    }
+
+    void WorkerLoop()
+    {
+        while(true)
+        {
+            std::function<bool()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_jobMutex);
+                m_jobCondition.wait(lock, [this]() { return m_quit || !m_jobs.empty(); });
+                if(m_quit)
+                {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+            // Generic jobs have nothing left for Pump(), so they are done here.
+            if(!job())
+            {
+                std::lock_guard<std::mutex> lock(m_jobMutex);
+                --m_pending;
+            }
+        }
+    }
+
+    std::vector<std::thread> m_workers;///< Decoding threads.
+
+    std::mutex m_jobMutex;///< Guards m_jobs, m_pending and m_quit.
+    std::condition_variable m_jobCondition;///< Wakes the workers.
+    std::deque<std::function<bool()>> m_jobs;///< Work not started yet.
+    int m_pending = 0;///< Assets not finished yet.
+    bool m_quit = false;///< Set when the loader is destroyed.
+
+    std::mutex m_decodedMutex;///< Guards m_decoded.
+    std::deque<Decoded> m_decoded;///< Assets waiting for Pump().
+};
+
+#endif /* AsyncLoader_hpp */
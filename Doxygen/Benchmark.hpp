@@ -0,0 +1,589 @@
+#ifndef Benchmark_hpp
+#define Benchmark_hpp
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#elif defined(__APPLE__)
+    #include <SDL2/SDL.h>
+#else
+    #include <SDL.h>
+#endif
+
+#if defined(LINUX) || defined(__APPLE__)
+    #include <sys/resource.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Engine.hpp"
+#include "Profiler.hpp"
+#include "Vector2Batch.hpp"
+
+/**
+ * @struct BenchmarkConfig
+ * @brief Options of a benchmark run, read from the command line by BenchmarkMain.
+ */
+struct BenchmarkConfig
+{
+    int frames = 600;///< Frames run by each scenario.
+    int dt = 16;///< Fixed delta time of each frame in milliseconds.
+    int width = 1280;///< Width of the headless surface.
+    int height = 720;///< Height of the headless surface.
+    std::string scenario;///< Only run the scenario of this name, all of them when empty.
+    std::string animationPath;///< Animation file for the animated sprite scenario, which is skipped when empty.
+    std::string animationName;///< Animation started on every animated sprite.
+    std::string outputPath;///< File the results are written to, stdout when empty.
+    bool software = false;///< Draw with the software rasterizer instead of the SDL renderer.
+    SampleFilter filter = nearest;///< Sampling of the software rasterizer.
+    std::string frameOutput;///< Directory the software frames are written to, none when empty.
+};
+
+/**
+ * @struct BenchmarkContext
+ * @brief Resources of a running scenario, released after the engine shut down.
+ */
+struct BenchmarkContext
+{
+    BenchmarkConfig const* config = nullptr;///< Options of the run.
+    Camera* camera = nullptr;///< Camera moved by the scenario, if any.
+    std::vector<SDL_Texture*> textures;///< Textures created by the scenario.
+    std::string failure;///< Set by a step whose check failed, which fails the run.
+};
+
+/**
+ * @struct BenchmarkScenario
+ * @brief A scene to build and the work to do before each of its frames.
+ */
+struct BenchmarkScenario
+{
+    std::string name;///< Name in the results and on the command line.
+    std::function<bool(Engine&, BenchmarkContext&)> setup;///< Builds the scene, returns false to skip the scenario.
+    std::function<void(Engine&, BenchmarkContext&, int)> step;///< Called before every frame with its index, may be empty.
+};
+
+/**
+ * @struct BenchmarkResult
+ * @brief Measurements of one scenario.
+ */
+struct BenchmarkResult
+{
+    std::string name;///< Name of the scenario.
+    bool skipped = false;///< Whether the scenario could not run with the given options.
+    int frames = 0;///< Frames run.
+    double seconds = 0.0;///< Wall time of all frames, setup excluded.
+    double fps = 0.0;///< Frames per second.
+    long peakRssKb = 0;///< Peak resident memory of the process when the scenario ended.
+    std::vector<std::pair<std::string, ProfileStats>> scopes;///< Per frame time of every profiled scope.
+    std::string failure;///< Why a check of the scenario failed, empty when it passed.
+};
+
+/**
+ * \brief Peak resident memory of the process
+ * @return kilobytes, 0 where the platform does not report it
+ */
+inline long GetPeakRssKb()
+{
+#if defined(LINUX) || defined(__APPLE__)
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return static_cast<long>(usage.ru_maxrss / 1024);
+#else
+    return static_cast<long>(usage.ru_maxrss);
+#endif
+#else
+    return 0;
+#endif
+}
+
+/**
+ * \brief Create a checkerboard texture, so scenarios need no asset on disk
+ * @param renderer renderer owning the texture
+ * @param width width of the texture
+ * @param height height of the texture
+ * @param cell size of the checker squares
+ * @param software rasterizer the pixels are also given to, if any
+ * @param lightAlpha alpha of the light squares, below 255 to exercise blending
+ * @return the texture, nullptr if it could not be created
+ */
+inline SDL_Texture* CreateBenchmarkTexture(SDL_Renderer* renderer, int width, int height, int cell,
+                                           SoftwareRasterizer* software = nullptr, Uint8 lightAlpha = 255)
+{
+    SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, width, height);
+    if(!texture)
+    {
+        return nullptr;
+    }
+    std::vector<Uint32> pixels(static_cast<size_t>(width) * height);
+    for(int y = 0; y < height; ++y)
+    {
+        for(int x = 0; x < width; ++x)
+        {
+            bool dark = ((x / cell) + (y / cell)) % 2 == 0;
+            pixels[static_cast<size_t>(y) * width + x] = dark ? 0xFF404040u : (static_cast<Uint32>(lightAlpha) << 24) | 0xC0C0C0u;
+        }
+    }
+    SDL_UpdateTexture(texture, nullptr, pixels.data(), width * static_cast<int>(sizeof(Uint32)));
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    if(software)
+    {
+        software->RegisterTexture(texture, pixels.data(), width, height);
+    }
+    return texture;
+}
+
+/**
+ * \brief The built-in scenarios
+ * bodies_10k: 10000 dynamic boxes falling onto a static floor.
+ * tiles_1m: a 1000 x 1000 tile map scrolled by the main camera, so new chunks are baked as they come into view.
+ * animated_5k: 5000 animated sprites, needs an animation file in the config.
+ * sprites_20k: 20000 scaled, half transparent sprites submitted straight to the render queue every frame.
+ * vector2_batch_1m: one million positions integrated and culled every frame, once with Vector2 in a loop and once
+ * with the kernels of Vector2Batch.hpp; compare the "Vector2Batch::*Scalar" and "Vector2Batch::*Batch" scopes.
+ * steady_allocations: 2000 boxes settling on a floor under a moving camera, which fails if any frame after the
+ * first 120 calls the global allocator; needs a build defining ENGINE_COUNT_ALLOCATIONS, skipped otherwise.
+ */
+inline std::vector<BenchmarkScenario> DefaultBenchmarkScenarios()
+{
+    std::vector<BenchmarkScenario> scenarios;
+
+    BenchmarkScenario bodies;
+    bodies.name = "bodies_10k";
+    bodies.setup = [](Engine& engine, BenchmarkContext&)
+    {
+        GameObject* floor = engine.CreateStaticObject();
+        floor->GetTransform()->SetPosition(Vector2(1600.0f, 2000.0f));
+        floor->GetTransform()->SetSize(Vector2(3200.0f, 32.0f));
+        floor->GetPhysicalEngine()->AddGameObject(floor);
+        for(int i = 0; i < 10000; ++i)
+        {
+            GameObject* box = engine.CreateObject();
+            box->GetTransform()->SetPosition(Vector2(static_cast<float>(i % 100) * 24.0f + 400.0f,
+                                                     static_cast<float>(i / 100) * 24.0f - 600.0f));
+            box->GetTransform()->SetSize(Vector2(16.0f, 16.0f));
+            box->GetPhysicalEngine()->AddGameObject(box);
+        }
+        return true;
+    };
+    scenarios.push_back(bodies);
+
+    BenchmarkScenario tiles;
+    tiles.name = "tiles_1m";
+    tiles.setup = [](Engine& engine, BenchmarkContext& context)
+    {
+        SDL_Texture* sheet = CreateBenchmarkTexture(engine.GetRenderer(), 64, 64, 16);
+        if(!sheet)
+        {
+            return false;
+        }
+        context.textures.push_back(sheet);
+        const int size = 1000;
+        TileMap* map = new TileMap(engine.GetRenderer(), sheet, 16, 16, 4, 4, size, size);
+        for(int row = 0; row < size; ++row)
+        {
+            for(int col = 0; col < size; ++col)
+            {
+                map->SetTile(col, row, (col * 7 + row * 3) % 16);
+            }
+        }
+        engine.CreateTileMap(map);
+        GameObject* holder = engine.CreateObject();
+        context.camera = holder->AddComponent(new Camera(context.config->width, context.config->height));
+        context.camera->followOwner = false;
+        context.camera->position = Vector2(context.config->width * 0.5f, context.config->height * 0.5f);
+        engine.SetMainCamera(context.camera);
+        return true;
+    };
+    tiles.step = [](Engine&, BenchmarkContext& context, int)
+    {
+        context.camera->position.x += 8.0f;
+        context.camera->position.y += 4.0f;
+    };
+    scenarios.push_back(tiles);
+
+    BenchmarkScenario animated;
+    animated.name = "animated_5k";
+    animated.setup = [](Engine& engine, BenchmarkContext& context)
+    {
+        BenchmarkConfig const& config = *context.config;
+        if(config.animationPath.empty())
+        {
+            return false;
+        }
+        for(int i = 0; i < 5000; ++i)
+        {
+            GameObject* object = engine.CreateObject();
+            object->GetTransform()->SetPosition(Vector2(static_cast<float>((i % 100) * config.width / 100),
+                                                        static_cast<float>((i / 100) * config.height / 50)));
+            Animator* animator = object->AddComponent(new Animator(engine.GetRenderer()));
+            animator->GetAnimations(config.animationPath);
+            animator->StartAnimation(config.animationName, loop);
+        }
+        return true;
+    };
+    scenarios.push_back(animated);
+
+    BenchmarkScenario sprites;
+    sprites.name = "sprites_20k";
+    sprites.setup = [](Engine& engine, BenchmarkContext& context)
+    {
+        SDL_Texture* texture = CreateBenchmarkTexture(engine.GetRenderer(), 32, 32, 8,
+                                                      engine.GetGraphicsEngineRenderer()->GetSoftwareRasterizer(), 160);
+        if(!texture)
+        {
+            return false;
+        }
+        context.textures.push_back(texture);
+        return true;
+    };
+    sprites.step = [](Engine& engine, BenchmarkContext& context, int frame)
+    {
+        BenchmarkConfig const& config = *context.config;
+        RenderQueue* queue = engine.GetGraphicsEngineRenderer()->GetRenderQueue();
+        SpriteCommand command;
+        command.texture = context.textures[0];
+        command.src = SDL_Rect{0, 0, 32, 32};
+        for(int i = 0; i < 20000; ++i)
+        {
+            int size = 24 + (i % 3) * 8;
+            command.dst = SDL_Rect{(i * 37 + frame * 3) % config.width - 16, (i * 53 + frame) % config.height - 16,
+                                   size, size};
+            command.layer = i % 4;
+            queue->Submit(command);
+        }
+    };
+    scenarios.push_back(sprites);
+
+    /**
+     * @struct BatchData
+     * @brief The same points as an array of Vector2 and as separate x and y arrays
+     */
+    struct BatchData
+    {
+        std::vector<Vector2> positions;
+        std::vector<Vector2> velocities;
+        std::vector<uint8_t> visible;
+        std::vector<float> x, y, vx, vy, maxX, maxY;
+    };
+    std::shared_ptr<BatchData> batch = std::make_shared<BatchData>();
+    BenchmarkScenario vectors;
+    vectors.name = "vector2_batch_1m";
+    vectors.setup = [batch](Engine&, BenchmarkContext&)
+    {
+        const size_t count = 1000000;
+        batch->positions.resize(count);
+        batch->velocities.resize(count);
+        batch->visible.resize(count);
+        batch->x.resize(count);
+        batch->y.resize(count);
+        batch->vx.resize(count);
+        batch->vy.resize(count);
+        batch->maxX.resize(count);
+        batch->maxY.resize(count);
+        for(size_t i = 0; i < count; ++i)
+        {
+            batch->positions[i] = Vector2(static_cast<float>(i % 1000) * 4.0f, static_cast<float>(i / 1000) * 4.0f);
+            batch->velocities[i] = Vector2(static_cast<float>(i % 7) - 3.0f, static_cast<float>(i % 5) - 2.0f);
+            batch->x[i] = batch->positions[i].x;
+            batch->y[i] = batch->positions[i].y;
+            batch->vx[i] = batch->velocities[i].x;
+            batch->vy[i] = batch->velocities[i].y;
+        }
+        return true;
+    };
+    vectors.step = [batch](Engine&, BenchmarkContext& context, int frame)
+    {
+        BenchmarkConfig const& config = *context.config;
+        float dt = config.dt / 1000.0f;
+        size_t count = batch->positions.size();
+        float left = static_cast<float>(frame % 1000);
+        float top = static_cast<float>(frame % 1000);
+        float right = left + config.width;
+        float bottom = top + config.height;
+        {
+            PROFILE_SCOPE("Vector2Batch::IntegrateScalar");
+            for(size_t i = 0; i < count; ++i)
+            {
+                batch->positions[i] += batch->velocities[i] * dt;
+            }
+        }
+        {
+            PROFILE_SCOPE("Vector2Batch::IntegrateBatch");
+            IntegratePositions(batch->x.data(), batch->y.data(), batch->vx.data(), batch->vy.data(), dt, count);
+        }
+        {
+            PROFILE_SCOPE("Vector2Batch::CullScalar");
+            for(size_t i = 0; i < count; ++i)
+            {
+                Vector2 const& p = batch->positions[i];
+                batch->visible[i] = static_cast<uint8_t>(p.x <= right && p.x + 16.0f >= left
+                                                         && p.y <= bottom && p.y + 16.0f >= top);
+            }
+        }
+        {
+            PROFILE_SCOPE("Vector2Batch::CullBatch");
+            for(size_t i = 0; i < count; ++i)
+            {
+                batch->maxX[i] = batch->x[i] + 16.0f;
+                batch->maxY[i] = batch->y[i] + 16.0f;
+            }
+            OverlapAabbBatch(batch->x.data(), batch->y.data(), batch->maxX.data(), batch->maxY.data(), count,
+                             left, top, right, bottom, batch->visible.data());
+        }
+    };
+    scenarios.push_back(vectors);
+
+    BenchmarkScenario steady;
+    steady.name = "steady_allocations";
+    steady.setup = [](Engine& engine, BenchmarkContext& context)
+    {
+#if defined(ENGINE_COUNT_ALLOCATIONS)
+        GameObject* floor = engine.CreateStaticObject();
+        floor->GetTransform()->SetPosition(Vector2(context.config->width * 0.5f, context.config->height - 16.0f));
+        floor->GetTransform()->SetSize(Vector2(static_cast<float>(context.config->width), 32.0f));
+        floor->GetPhysicalEngine()->AddGameObject(floor);
+        for(int i = 0; i < 2000; ++i)
+        {
+            GameObject* box = engine.CreateObject();
+            box->GetTransform()->SetPosition(Vector2(static_cast<float>(i % 50) * 20.0f + 100.0f,
+                                                     static_cast<float>(i / 50) * 20.0f - 400.0f));
+            box->GetTransform()->SetSize(Vector2(16.0f, 16.0f));
+            box->GetPhysicalEngine()->AddGameObject(box);
+        }
+        GameObject* holder = engine.CreateObject();
+        context.camera = holder->AddComponent(new Camera(context.config->width, context.config->height));
+        context.camera->followOwner = false;
+        context.camera->position = Vector2(context.config->width * 0.5f, context.config->height * 0.5f);
+        engine.SetMainCamera(context.camera);
+        return true;
+#else
+        (void)engine;
+        (void)context;
+        return false;
+#endif
+    };
+    steady.step = [](Engine& engine, BenchmarkContext& context, int frame)
+    {
+        // The first frames fill the frame arenas, the pools and the caches; after them nothing may allocate.
+        const int warmupFrames = 120;
+        context.camera->position.x += frame % 120 < 60 ? 2.0f : -2.0f;
+        uint64_t allocations = engine.GetFrameAllocationCount();
+        if(frame > warmupFrames && allocations != 0 && context.failure.empty())
+        {
+            context.failure = std::to_string(allocations) + " allocations in frame " + std::to_string(frame - 1);
+        }
+    };
+    scenarios.push_back(steady);
+
+    return scenarios;
+}
+
+/**
+ * \brief Build a scenario in a fresh headless engine and run it with the fixed delta time of the config
+ * @param scenario scenario to run
+ * @param config options of the run
+ * @return measurements, with skipped set if the scenario could not be built
+ */
+inline BenchmarkResult RunBenchmark(BenchmarkScenario const& scenario, BenchmarkConfig const& config)
+{
+    BenchmarkResult result;
+    result.name = scenario.name;
+    BenchmarkContext context;
+    context.config = &config;
+    {
+        Engine engine;
+        engine.InitializeHeadless(config.width, config.height);
+        if(config.software)
+        {
+            engine.EnableSoftwareRasterizer(config.filter);
+            engine.GetGraphicsEngineRenderer()->SetFrameOutput(config.frameOutput);
+        }
+        engine.Start();
+        if(!scenario.setup(engine, context))
+        {
+            result.skipped = true;
+        }
+        else
+        {
+            // Warm up once so first-frame costs like the Start of every object stay out of the statistics.
+            engine.RunFrames(1, config.dt);
+            Profiler::GetInstance().ResetStats();
+            uint64_t start = Profiler::Now();
+            for(int frame = 0; frame < config.frames; ++frame)
+            {
+                if(scenario.step)
+                {
+                    scenario.step(engine, context, frame);
+                }
+                engine.RunFrames(1, config.dt);
+            }
+            result.seconds = (Profiler::Now() - start) / 1e9;
+            result.failure = context.failure;
+            result.frames = config.frames;
+            result.fps = result.seconds > 0.0 ? config.frames / result.seconds : 0.0;
+            Profiler& profiler = Profiler::GetInstance();
+            for(std::string const& name : profiler.GetScopeNames())
+            {
+                result.scopes.push_back(std::make_pair(name, profiler.GetStats(name)));
+            }
+        }
+        engine.Shutdown();
+    }
+    for(SDL_Texture* texture : context.textures)
+    {
+        SDL_DestroyTexture(texture);
+    }
+    result.peakRssKb = GetPeakRssKb();
+    return result;
+}
+
+/**
+ * \brief Write results as JSON
+ * @param file destination
+ * @param results results of the scenarios
+ */
+inline void WriteBenchmarkJson(FILE* file, std::vector<BenchmarkResult> const& results)
+{
+    std::fputs("{\"benchmarks\":[", file);
+    for(size_t i = 0; i < results.size(); ++i)
+    {
+        BenchmarkResult const& result = results[i];
+        std::fprintf(file, "%s\n{\"name\":\"%s\",\"skipped\":%s,\"frames\":%d,\"seconds\":%.6f,\"fps\":%.2f,"
+                     "\"peak_rss_kb\":%ld,\"failure\":\"%s\",\"scopes\":{",
+                     i == 0 ? "" : ",", result.name.c_str(), result.skipped ? "true" : "false", result.frames,
+                     result.seconds, result.fps, result.peakRssKb, result.failure.c_str());
+        for(size_t j = 0; j < result.scopes.size(); ++j)
+        {
+            ProfileStats const& stats = result.scopes[j].second;
+            std::fprintf(file, "%s\"%s\":{\"min_ms\":%.4f,\"avg_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f}",
+                         j == 0 ? "" : ",", result.scopes[j].first.c_str(), stats.minMs, stats.avgMs, stats.p99Ms,
+                         stats.maxMs);
+        }
+        std::fputs("}}", file);
+    }
+    std::fputs("\n]}\n", file);
+}
+
+/**
+ * \brief Entry point of a benchmark executable: int main(int argc, char** argv) { return BenchmarkMain(argc, argv); }
+ * Options: --frames N, --dt MS, --size WxH, --scenario NAME, --animation PATH NAME, --output PATH, --list,
+ * --software [nearest|bilinear] to draw with the software rasterizer, --frames-to DIR to also write its frames.
+ * Peak memory is the peak of the whole process, so run one scenario per process to compare it between scenarios.
+ * @return 0 on success, 1 on bad options, if the output could not be written or if a scenario failed its check
+ */
+inline int BenchmarkMain(int argc, char** argv)
+{
+    BenchmarkConfig config;
+    std::vector<BenchmarkScenario> scenarios = DefaultBenchmarkScenarios();
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(option == "--frames" && hasValue)
+        {
+            config.frames = std::atoi(argv[++i]);
+        }
+        else if(option == "--dt" && hasValue)
+        {
+            config.dt = std::atoi(argv[++i]);
+        }
+        else if(option == "--size" && hasValue)
+        {
+            if(std::sscanf(argv[++i], "%dx%d", &config.width, &config.height) != 2)
+            {
+                std::printf("Bad size %s, expected WxH\n", argv[i]);
+                return 1;
+            }
+        }
+        else if(option == "--scenario" && hasValue)
+        {
+            config.scenario = argv[++i];
+        }
+        else if(option == "--animation" && i + 2 < argc)
+        {
+            config.animationPath = argv[++i];
+            config.animationName = argv[++i];
+        }
+        else if(option == "--output" && hasValue)
+        {
+            config.outputPath = argv[++i];
+        }
+        else if(option == "--software")
+        {
+            config.software = true;
+            if(hasValue && std::strcmp(argv[i + 1], "bilinear") == 0)
+            {
+                config.filter = bilinear;
+                ++i;
+            }
+            else if(hasValue && std::strcmp(argv[i + 1], "nearest") == 0)
+            {
+                ++i;
+            }
+        }
+        else if(option == "--frames-to" && hasValue)
+        {
+            config.frameOutput = argv[++i];
+        }
+        else if(option == "--list")
+        {
+            for(BenchmarkScenario const& scenario : scenarios)
+            {
+                std::printf("%s\n", scenario.name.c_str());
+            }
+            return 0;
+        }
+        else
+        {
+            std::printf("Unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<BenchmarkResult> results;
+    for(BenchmarkScenario const& scenario : scenarios)
+    {
+        if(config.scenario.empty() || config.scenario == scenario.name)
+        {
+            results.push_back(RunBenchmark(scenario, config));
+        }
+    }
+    if(results.empty())
+    {
+        std::printf("No scenario named %s\n", config.scenario.c_str());
+        return 1;
+    }
+
+    FILE* file = config.outputPath.empty() ? stdout : std::fopen(config.outputPath.c_str(), "w");
+    if(!file)
+    {
+        std::printf("Could not write the results to %s\n", config.outputPath.c_str());
+        return 1;
+    }
+    WriteBenchmarkJson(file, results);
+    if(file != stdout)
+    {
+        std::fclose(file);
+    }
+    for(BenchmarkResult const& result : results)
+    {
+        if(!result.failure.empty())
+        {
+            std::printf("%s failed: %s\n", result.name.c_str(), result.failure.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#endif /* Benchmark_hpp */
@@ -17,24 +17,20 @@
 
 #include "Component.hpp"
 #include "ResourceManager.hpp"
-#include "document.h"
-#include "filereadstream.h"
+#include "RenderQueue.hpp"
+#include "AnimationLibrary.hpp"
+#include "AnimationSystem.hpp"
+#include "CookedScene.hpp"
 
 
-using namespace rapidjson;
-/**
- * @enum AnimationModel
- * @brief animation model
- */
-enum AnimationModel
-{
-    single,///play the animation once
-    loop///play the animation
-};
-
 /**
  * @class Animator
  * @brief class of animator component.
+ * @details The clips are shared through the AnimationLibrary of the ResourceManager, so an animator only holds
+ * pointers to its set and current clip plus when and how fast it started playing. The frame shown is computed from
+ * the AnimationSystem clock when it is rendered, so Update does nothing and a culled animator costs nothing.
+ * The per animator frame data that used to be public (m_Frames, m_CurrentFrame, m_Timer, m_texture and the sheet
+ * layout) is gone: use GetCurrentFrame and GetCurrentClip instead.
  */
 class Animator:public Component
 {
@@ -47,23 +43,30 @@ public:
     Animator(SDL_Renderer* renderer);
     
     void Start() override;
+    /**
+     *@brief nothing to do, the frame is a function of the animation clock
+     */
     void Update(int dt) override;
+    /**
+     *@brief Submit the current frame at the interpolated transform position to the render queue, or draw it right away if there is no queue
+     *The queue culls it against the main camera, if any.
+     */
     void Render() override;
+    const char* GetName() const override { return "Animator"; }
+    ComponentTypeId GetTypeId() const override { return ComponentTypeRegistry::GetId<Animator>(); }
     /**
-     *@brief read animations file form a path
+     *@brief use the animations of a file, which is parsed only the first time any animator asks for it
+     *@param path path of the animation file
      */
-    void GetAnimations(std::string path);
-    
-    //void GetAnimations(rapidjson::Document document);
-    
-    std::vector<SDL_Rect> m_Frames;///< rects to locate each frame
+    void GetAnimations(std::string const& path);
+    /**
+     *@brief take the animations from a cooked scene instead of parsing a file
+     *@param scene open cooked scene
+     *@param set animation set of the scene
+     */
+    void GetAnimations(CookedScene const& scene, CookedAnimationSet const& set);
     
-    int m_CurrentFrame;///< current animation frame
-    int m_StartFrame;///< start frame of current animation
-    int m_LastFrame;///< last frame of current animation
-    int m_AnimationFPS;///< animation update time
-    int m_lastTime;///< time counter
-    int m_Timer;///< time counter
+    int layer = 0;///< sorting layer, higher layers are drawn on top
 
     //--------------exposed to uesrs--------------
     /**
@@ -71,31 +74,85 @@ public:
      *@param name the name of the animation
      *@param model animation model
      */
-    void StartAnimation(std::string name, AnimationModel model);
+    void StartAnimation(std::string const& name, AnimationModel model);
+    /**
+     *@brief start a clip by id, without looking its name up
+     *Restarts the clip: m_startTime is the current clock and m_offset 0.
+     *@param clip id of the clip, from GetClipId
+     *@param model animation model
+     */
+    void StartAnimation(AnimationClipId clip, AnimationModel model);
+    /**
+     *@brief get the id of an animation of the current set
+     *@param name the name of the animation
+     *@return id of the clip, kInvalidClip if the set has no such animation
+     */
+    AnimationClipId GetClipId(std::string const& name) const;
     /**
      *@brief get the name of current animation
      */
     std::string GetCurrentAnimation();
     /**
-     *@brief stop the current animation
+     *@brief get the clip being played
+     *@return the clip, nullptr if no animation was started
+     */
+    AnimationClip const* GetCurrentClip() const
+    {
+        return m_clip;
+    }
+    /**
+     *@brief get the frame of the current clip shown now
+     *@return index in the frames of the clip, 0 if no animation was started
+     */
+    int GetCurrentFrame() const
+    {
+        return m_clip ? SampleClipFrame(*m_clip, GetElapsed(AnimationSystem::GetTime()), m_model) : 0;
+    }
+    /**
+     *@brief change the playing speed, keeping the current frame
+     *@param speed 1 for the fps of the clip, 2 for twice as fast
+     */
+    void SetSpeed(float speed)
+    {
+        uint32_t now = AnimationSystem::GetTime();
+        m_offset = GetElapsed(now);
+        m_startTime = now;
+        m_speed = speed;
+    }
+    /**
+     *@brief stop the current animation, holding its current frame
+     *Stores GetElapsed of the current clock in m_offset before setting m_stop.
      */
     void StopAnimation();
     /**
      *@brief continue playing the current animation
+     *Moves m_startTime to the current clock, so playing resumes from the held frame.
      */
     void ContinueAnimation();
+    /**
+     *@brief set the queue the animation frames are submitted to
+     *@param queue render queue, nullptr to draw immediately
+     */
+    void SetRenderQueue(RenderQueue* queue);
     
 private:
     SDL_Renderer* m_renderer;///<current renderer
-    SDL_Texture* m_texture;///< animation texture
-    AnimationModel m_model;///< animation mode
-    int m_spriteWidth;///< width of each sprite
-    int m_spriteHeight;///< height of each sprite
-    int m_col;///< cols of sprites
-    int m_row;///< rows of sprites
-    bool m_stop;///< stop updateing
-    std::string m_currentAnimation;///< current animation name
-    rapidjson::Document m_document;///< animation information json file
+    RenderQueue* m_renderQueue = nullptr;///< queue the frames are submitted to
+    AnimationSet const* m_set = nullptr;///< animations this animator can play, owned by the library
+    AnimationClip const* m_clip = nullptr;///< clip being played, owned by the library
+    AnimationModel m_model = loop;///< animation mode
+    uint32_t m_startTime = 0;///< animation clock time the clip started, or the speed or stop state last changed
+    double m_offset = 0.0;///< playing time of the clip at m_startTime in milliseconds
+    float m_speed = 1.0f;///< playing speed
+    bool m_stop = false;///< whether the clip is held at m_offset
+
+    /**
+     *@brief playing time of the clip at a clock time, in milliseconds of the clip
+     */
+    double GetElapsed(uint32_t time) const
+    {
+        return m_stop ? m_offset : m_offset + static_cast<double>(time - m_startTime) * m_speed;
+    }
 };
 
 
@@ -0,0 +1,94 @@
+#ifndef Camera_hpp
+#define Camera_hpp
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#elif defined(__APPLE__)
+    #include <SDL2/SDL.h>
+#else
+    #include <SDL.h>
+#endif
+
+#include <cstdio>
+
+#include "Component.hpp"
+#include "Vector2.hpp"
+#include "RenderQueue.hpp"
+
+/**
+ * @class Camera
+ * @brief camera component, decides which part of the world is drawn on screen.
+ */
+class Camera : public Component
+{
+public:
+    /**
+     *@brief Constructor
+     */
+    Camera();
+    /**
+     *@brief Constructor
+     *@param width width of the viewport on screen
+     *@param height height of the viewport on screen
+     */
+    Camera(int width, int height);
+    /**
+     *@brief Destructor
+     */
+    ~Camera();
+    /**
+     * \brief Follow the transform of the owner if followOwner is set
+     * @param dt
+     */
+    void Update(int dt) override;
+    /**
+     * \brief Empty render
+     */
+    void Render() override;
+    const char* GetName() const override { return "Camera"; }
+    ComponentTypeId GetTypeId() const override { return ComponentTypeRegistry::GetId<Camera>(); }
+
+    /**
+     * \brief Get the view used to cull and place sprites
+     *
+     * @return current view
+     */
+    RenderView GetView() const
+    {
+        RenderView view;
+        view.x = position.x;
+        view.y = position.y;
+        view.zoom = zoom;
+        view.viewport = viewport;
+        return view;
+    }
+
+    /**
+     * \brief Get the part of the world that is visible
+     *
+     * @return world rect, also what the tile map is drawn for
+     */
+    SDL_Rect GetWorldBounds() const
+    {
+        return GetView().GetWorldBounds();
+    }
+
+    /**
+     * \brief Whether a rect of the world can be seen by the camera
+     *
+     * @param world rect in world units
+     * @return visibility
+     */
+    bool IsVisible(SDL_Rect const& world) const
+    {
+        return GetView().IsVisible(world);
+    }
+
+    //--------------exposed to users--------------
+    Vector2 position;///position of the world shown at the center of the viewport
+    float zoom = 1.0f;///screen pixels per world unit, used as kMinViewZoom when smaller
+    SDL_Rect viewport{0, 0, 640, 480};///area of the screen the camera draws to
+    bool followOwner = true;///whether the camera moves with the transform of its gameObject
+};
+
+#endif /* Camera_hpp */
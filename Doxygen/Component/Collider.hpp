@@ -2,6 +2,8 @@
 #define Collider_hpp
 
 #include <cstdio>
+#include <cstddef>
+#include <functional>
 #include <vector>
 
 #include "Vector2.hpp"
@@ -10,13 +12,37 @@
 /**
  * @struct Contact
  * @brief infomation of collides
+ * @details points used to be a std::vector; it is a fixed array now so caching contacts does not allocate, and
+ * numOfPoints replaces its size().
  */
 struct Contact {
+    static const int kMaxPoints = 2;///< most points box2d reports for one contact
     GameObject* other = nullptr;
     int numOfPoints = 0;
-    std::vector<Vector2> points;
+    Vector2 points[kMaxPoints];///< first numOfPoints entries are valid
 };
 
+/**
+ * @struct ContactSpan
+ * @brief read-only view of contacts owned by the physics engine, valid until the next physics step
+ */
+struct ContactSpan {
+    Contact const* first = nullptr;
+    Contact const* last = nullptr;
+    
+    Contact const* begin() const { return first; }
+    Contact const* end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    bool empty() const { return first == last; }
+    Contact const& operator[](size_t i) const { return first[i]; }
+};
+
+/**
+ * @brief called with the other game object when a contact begins or ends
+ * In an exit callback, other is nullptr when the other object was removed while touching this one.
+ */
+typedef std::function<void(GameObject* other)> CollisionCallback;
+
 /**
  * @class Collider
  * @brief collider component of game objects.
@@ -41,20 +67,60 @@ public:
      * \brief Empty render
      */
     void Render() override;
+    const char* GetName() const override { return "Collider"; }
+    ComponentTypeId GetTypeId() const override { return ComponentTypeRegistry::GetId<Collider>(); }
     
     //--------------exposed to users--------------
     /**
      * Get the contact list of current object
+     * \warning copies the contacts, prefer GetContacts in per-frame code
      *
      * @return contact list
      */
     std::vector<Contact> GetContactList();
     /**
      * \brief Get the contact list of sensors that collide with the game object
+     * \warning copies the contacts, prefer GetSensorContacts in per-frame code
      *
      * @return contact list
      */
     std::vector<Contact> GetSensorContactList();
+    /**
+     * \brief Get the contacts of current object recorded in the last physics step, without copying
+     *
+     * @return view of the contacts, valid until the next physics step
+     */
+    ContactSpan GetContacts() const;
+    /**
+     * \brief Get the contacts with sensors recorded in the last physics step, without copying
+     *
+     * @return view of the contacts, valid until the next physics step
+     */
+    ContactSpan GetSensorContacts() const;
+    /**
+     * \brief Set the function called after a physics step when a collision with another object begins
+     *
+     * @param callback
+     */
+    void SetOnCollisionEnter(CollisionCallback callback);
+    /**
+     * \brief Set the function called after a physics step when a collision with another object ends
+     *
+     * @param callback
+     */
+    void SetOnCollisionExit(CollisionCallback callback);
+    /**
+     * \brief Set the function called after a physics step when the object starts touching a sensor
+     *
+     * @param callback
+     */
+    void SetOnTriggerEnter(CollisionCallback callback);
+    /**
+     * \brief Set the function called after a physics step when the object stops touching a sensor
+     *
+     * @param callback
+     */
+    void SetOnTriggerExit(CollisionCallback callback);
     /**
      * /brief Set the collision scale of the object
      * i.e. the collision size in physical world is size * scale
@@ -80,6 +146,12 @@ public:
 private:
     float m_scale = 1.0f;
     bool m_isSensor = false;
+    CollisionCallback m_onCollisionEnter;
+    CollisionCallback m_onCollisionExit;
+    CollisionCallback m_onTriggerEnter;
+    CollisionCallback m_onTriggerExit;
+
+    friend class PhysicsEngine;
 };
 
 #endif /* Collider_hpp */
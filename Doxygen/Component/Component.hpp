@@ -2,9 +2,49 @@
 #define COMPONENT_HPP
 
 #include <iostream>
+#include <atomic>
+#include <cstdint>
 
 class GameObject;
 
+/**
+ * @brief Index of a component type, used to address the slot table of game objects.
+ */
+typedef uint32_t ComponentTypeId;
+
+/**
+ * @brief Type id of a component whose class does not override Component::GetTypeId.
+ */
+const ComponentTypeId kUnknownComponentType = 0xFFFFFFFFu;
+
+/**
+ * @class ComponentTypeRegistry
+ * @brief Gives every component type a small integer id at the first time it is asked for, without RTTI.
+ */
+class ComponentTypeRegistry{
+public:
+    /**
+     *@brief Get the id of a component type
+     *@return id of T, the same for the whole run of the program
+     */
+    template <typename T>
+    static ComponentTypeId GetId()
+    {
+        static const ComponentTypeId id = NextId();
+        return id;
+    }
+    
+private:
+    /**
+     *@brief Hand out the next unused id
+     */
+    static ComponentTypeId NextId()
+    {
+        static std::atomic<ComponentTypeId> next(0);
+        return next++;
+    }
+};
+
 /**
  * @class Component
  * @brief base class of components
@@ -16,9 +56,9 @@ public:
      */
     Component();
     /**
-     *@brief Destructor
+     *@brief Destructor, virtual so components can be deleted through a Component pointer
      */
-    ~Component();
+    virtual ~Component();
     
     /**
      *@brief run at the first frame of game
@@ -34,6 +74,17 @@ public:
      *@brief render on screen
      */
     virtual void Render();
+    /**
+     *@brief Name of the component type, used to label its updates in the profiler
+     *@return a string that lives as long as the program
+     */
+    virtual const char* GetName() const { return "Component"; }
+    /**
+     *@brief Id of the component type, used to register components added through a Component pointer
+     *Scripts override it as the built-in components do, returning ComponentTypeRegistry::GetId<TheirClass>().
+     *@return ComponentTypeRegistry::GetId of the concrete type, kUnknownComponentType if the class does not override it
+     */
+    virtual ComponentTypeId GetTypeId() const { return kUnknownComponentType; }
     /**
      *@brief Get the owner of this component
      *@return owner as a GameObject
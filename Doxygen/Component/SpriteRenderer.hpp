@@ -18,6 +18,9 @@
 #include "Transform.hpp"
 #include "Component.hpp"
 #include "Transform.hpp"
+#include "RenderQueue.hpp"
+#include "TextureAtlas.hpp"
+#include "ResourceManager.hpp"
 
 /**
  * @class SpriteRenderer
@@ -28,7 +31,13 @@ class SpriteRenderer:public Component
 public:
     void Start() override;
     void Update(int dt) override;
+    /**
+     *@brief Submit the sprite at the interpolated transform position to the render queue, or draw it right away if there is no queue
+     *The queue culls it against the main camera, if any.
+     */
     void Render() override;
+    const char* GetName() const override { return "SpriteRenderer"; }
+    ComponentTypeId GetTypeId() const override { return ComponentTypeRegistry::GetId<SpriteRenderer>(); }
     /**
      *@brief Constructor
      */
@@ -36,8 +45,10 @@ public:
     /**
      *@brief Constructor
      *@param path path of the sprite, src defaults to the size of the entire sprite
+     *The picture is resolved with ResourceManager::GetTextureRegionByPath, so a picture packed into an atlas is drawn
+     *from its page and sub-rect. A standalone texture is acquired, and released by the destructor or the next SetSprite.
      */
-    SpriteRenderer(SDL_Renderer* renderer, std::string path);
+    SpriteRenderer(SDL_Renderer* renderer, std::string const& path);
     /**
      *@brief Constructor
      *@param t texture
@@ -50,7 +61,7 @@ public:
      */
     SpriteRenderer(SDL_Renderer* renderer);
     /**
-     *@brief Destructor
+     *@brief Destructor, releases the texture acquired for a path
      */
     ~SpriteRenderer();
     /**
@@ -60,7 +71,19 @@ public:
      */
     void SetSpriteDetail(SDL_Texture* t, SDL_Rect rect);
     
-    void SetSprite(std::string path);
+    /**
+     *@brief set the picture of the sprite, resolved like the path constructor, so atlas pictures use their page
+     *@param path path of the picture
+     */
+    void SetSprite(std::string const& path);
+    /**
+     *@brief set the sprite to a region of a texture, such as a picture of an atlas page
+     *@param region texture and src rect
+     */
+    void SetSprite(TextureRegion const& region)
+    {
+        SetSpriteDetail(region.texture, region.rect);
+    }
 
     /**
      * \brief Get the destined sprite size, which is the size rendered on the screen
@@ -74,16 +97,25 @@ public:
      * @param size sprite size
      */
     void SetSpriteSize(Vector2 const& size);
+    /**
+     * \brief Set the queue the sprite is submitted to
+     *
+     * @param queue render queue, nullptr to draw immediately
+     */
+    void SetRenderQueue(RenderQueue* queue);
 
 
     //--------------exposed to user--------------
     Vector2 position;///relative position to the gameObject
     Vector2 size;///size of the sprite
+    int layer = 0;///sorting layer, higher layers are drawn on top
     
     
 private:
     SDL_Renderer* m_Renderer;
     SDL_Texture* m_texture;
+    TextureHandle m_textureHandle;///< texture acquired for the path of the sprite, invalid for atlas pictures and textures given directly
+    RenderQueue* m_renderQueue = nullptr;
     SDL_Rect src{0, 0, 64, 64};
     SDL_Rect des{0, 0, 64, 64};
 };
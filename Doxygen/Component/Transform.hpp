@@ -1,6 +1,7 @@
 #ifndef Transform_hpp
 #define Transform_hpp
 
+#include <cstdint>
 #include <cstdio>
 #include <iostream>
 
@@ -8,6 +9,7 @@
 #include "Vector2.hpp"
 
 class PhysicsEngine;
+class TransformSync;
 
 /**
  * @class Transform
@@ -36,17 +38,23 @@ public:
      */
     ~Transform();
     
+    /**
+     * / Calls ResetInterpolation, so a new object is drawn where it was placed instead of at the origin
+     */
     void Start() override;
     /**
-     * / Update the position of game object according to that of physical world
+     * / Nothing to sync: the physics engine writes the positions of awake bodies after each step
      *
      * @param dt time elapsed
      */
     void Update(int dt) override;
     void Render() override;
+    const char* GetName() const override { return "Transform"; }
+    ComponentTypeId GetTypeId() const override { return ComponentTypeRegistry::GetId<Transform>(); }
 
     /**
      * /brief Set the position of the object in physical world
+     * The body is moved before the next step, see TransformSync::MarkDirty.
      *
      * @param p position
      */
@@ -75,15 +83,58 @@ public:
      * @param size
      */
     void SetSize(Vector2 size);
+    /**
+     * \brief Draw the object at its current position until the next physics step, without interpolating
+     * Call it after assigning position directly, SetPosition already does.
+     */
+    void ResetInterpolation()
+    {
+        m_previousPosition = position;
+        m_renderPosition = position;
+    }
+    /**
+     * \brief Remember the current position as the state before the next physics step
+     */
+    void SavePreviousPosition()
+    {
+        m_previousPosition = position;
+    }
+    /**
+     * \brief Compute the position to draw at, between the last two physics steps
+     *
+     * @param alpha how far the current time is between the two steps, 0-1
+     */
+    void Interpolate(float alpha)
+    {
+        m_renderPosition = Vector2(m_previousPosition.x + (position.x - m_previousPosition.x) * alpha,
+                                   m_previousPosition.y + (position.y - m_previousPosition.y) * alpha);
+    }
+    /**
+     * \brief Get the interpolated position that renderers should use
+     *
+     * @return position to draw at
+     */
+    Vector2 GetRenderPosition() const
+    {
+        return m_renderPosition;
+    }
     
     
     //--------------exposed to users--------------
     Vector2 scale;///scale of the gameObject, when it changes, both sprite and collider will change.
-    Vector2 position;///position of the center of the gameObject
+    Vector2 position;///position of the center of the gameObject, call ResetInterpolation after assigning it directly
 
 private:
+    friend class TransformSync;
+    
     Vector2 m_center{0,0};
     Vector2 m_size{64.0f, 64.0f};
+    Vector2 m_previousPosition{0, 0};
+    Vector2 m_renderPosition{0, 0};
+    TransformSync* m_sync = nullptr;///< Sync of the region the body is in, nullptr if no body.
+    uint32_t m_syncIndex = 0xFFFFFFFFu;///< Slot in m_sync, none if no body.
+    uint32_t m_awakeStep = 0;///< Last step the body was awake after.
+    bool m_dirty = false;///< Whether the position still has to be written to the body.
 };
 
 #endif /* Transform_hpp */
@@ -0,0 +1,382 @@
+#ifndef ComponentStore_hpp
+#define ComponentStore_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+#include "Component.hpp"
+#include "Transform.hpp"
+#include "SpriteRenderer.hpp"
+#include "Animator.hpp"
+#include "Collider.hpp"
+#include "TransformSync.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+
+/**
+ * @brief Id of an entity inside a ComponentStore.
+ */
+typedef uint32_t Entity;
+
+/**
+ * @brief Id of an entity that does not exist.
+ */
+const Entity kInvalidEntity = 0xFFFFFFFFu;
+
+/**
+ * \brief Called by ComponentArray after it moved a component to another address, does nothing by default
+ */
+template <typename T>
+inline void OnComponentMoved(T&)
+{
+}
+
+/**
+ * \brief Point the physics sync at the new address of a transform
+ */
+inline void OnComponentMoved(Transform& transform)
+{
+    TransformSync::Relink(&transform);
+}
+
+/**
+ * \brief Called by ComponentArray before a component is overwritten or removed, does nothing by default
+ */
+template <typename T>
+inline void OnComponentRemoved(T&)
+{
+}
+
+/**
+ * \brief Stop syncing a transform with its body before it is destroyed
+ */
+inline void OnComponentRemoved(Transform& transform)
+{
+    TransformSync::Detach(&transform);
+}
+
+/**
+ * @class ComponentArray
+ * @brief Packed array of one type of component, indexed by entity.
+ * @details Components are stored by value in a contiguous vector so that systems can walk them linearly.
+ * Removing a component moves the last one into its place, so pointers returned by Get() are only valid
+ * until the next Add() or Remove() on the same array. Components that others point to are told where they moved,
+ * see OnComponentMoved.
+ */
+template <typename T>
+class ComponentArray
+{
+public:
+    /**
+     * \brief Add a component to an entity, replacing the existing one if any
+     * @param entity owner entity
+     * @param component component to copy into the array
+     * @return pointer to the stored component
+     */
+    T* Add(Entity entity, T component)
+    {
+        if(entity >= m_sparse.size())
+        {
+            m_sparse.resize(entity + 1, kInvalidEntity);
+        }
+        if(m_sparse[entity] != kInvalidEntity)
+        {
+            T& stored = m_dense[m_sparse[entity]];
+            OnComponentRemoved(stored);
+            stored = std::move(component);
+            OnComponentMoved(stored);
+            return &stored;
+        }
+        m_sparse[entity] = static_cast<uint32_t>(m_dense.size());
+        T const* data = m_dense.data();
+        m_dense.push_back(std::move(component));
+        m_entities.push_back(entity);
+        if(m_dense.data() != data)
+        {
+            for(T& moved : m_dense)
+            {
+                OnComponentMoved(moved);
+            }
+        }
+        else
+        {
+            OnComponentMoved(m_dense.back());
+        }
+        return &m_dense.back();
+    }
+
+    /**
+     * \brief Remove the component of an entity. Does nothing if the entity has none.
+     * @param entity owner entity
+     */
+    void Remove(Entity entity)
+    {
+        if(!Has(entity))
+        {
+            return;
+        }
+        uint32_t index = m_sparse[entity];
+        uint32_t last = static_cast<uint32_t>(m_dense.size() - 1);
+        OnComponentRemoved(m_dense[index]);
+        if(index != last)
+        {
+            m_dense[index] = std::move(m_dense[last]);
+            OnComponentMoved(m_dense[index]);
+            m_entities[index] = m_entities[last];
+            m_sparse[m_entities[index]] = index;
+        }
+        m_dense.pop_back();
+        m_entities.pop_back();
+        m_sparse[entity] = kInvalidEntity;
+    }
+
+    /**
+     * \brief Get the component of an entity
+     * @param entity owner entity
+     * @return pointer to the component, nullptr if the entity has none
+     */
+    T* Get(Entity entity)
+    {
+        return Has(entity) ? &m_dense[m_sparse[entity]] : nullptr;
+    }
+
+    /**
+     * \brief Whether an entity has this type of component
+     * @param entity owner entity
+     */
+    bool Has(Entity entity) const
+    {
+        return entity < m_sparse.size() && m_sparse[entity] != kInvalidEntity;
+    }
+
+    /**
+     * \brief Get the owner entity of the component at a packed index
+     * @param index index in the packed array
+     */
+    Entity EntityAt(size_t index) const
+    {
+        return m_entities[index];
+    }
+
+    /**
+     * \brief Number of components in the array
+     */
+    size_t Size() const
+    {
+        return m_dense.size();
+    }
+
+    T* begin() { return m_dense.data(); }
+    T* end() { return m_dense.data() + m_dense.size(); }
+
+private:
+    std::vector<T> m_dense;///< Packed components.
+    std::vector<Entity> m_entities;///< Owner entity of each packed component.
+    std::vector<uint32_t> m_sparse;///< Entity to packed index, kInvalidEntity when absent.
+};
+
+/**
+ * @class ComponentStore
+ * @brief Opt-in data-oriented storage for the built-in components.
+ * @details Transform, SpriteRenderer, Animator and Collider are kept in packed per-type arrays and
+ * updated by systems that iterate each array in order, calling the concrete member functions directly
+ * instead of going through the virtual Component interface of every game object.
+ * Systems run per type, so all transforms are updated before any animator and all sprites are drawn before any animation.
+ * Each system is timed in the profiler under the name of its component type, like components of game objects.
+ */
+class ComponentStore
+{
+public:
+    /**
+     * \brief Create a new entity, reusing the id of a destroyed one when possible
+     * @return id of the entity
+     */
+    Entity CreateEntity()
+    {
+        if(!m_freeEntities.empty())
+        {
+            Entity entity = m_freeEntities.back();
+            m_freeEntities.pop_back();
+            return entity;
+        }
+        return m_nextEntity++;
+    }
+
+    /**
+     * \brief Remove all components of an entity and recycle its id
+     * @param entity entity to destroy
+     */
+    void DestroyEntity(Entity entity)
+    {
+        m_transforms.Remove(entity);
+        m_spriteRenderers.Remove(entity);
+        m_animators.Remove(entity);
+        m_colliders.Remove(entity);
+        m_freeEntities.push_back(entity);
+    }
+
+    /**
+     * \brief Get the packed array of a component type
+     * @return pointer to the array, nullptr if the type is not stored here
+     */
+    template <typename T>
+    ComponentArray<T>* Array()
+    {
+        return nullptr;
+    }
+
+    /**
+     * \brief Get the component of an entity
+     * The pointer is only valid until the next Add() or Remove() on the array of T, see ComponentArray.
+     * @return pointer to the component, nullptr if the entity has none or the type is not stored here
+     */
+    template <typename T>
+    T* Get(Entity entity)
+    {
+        ComponentArray<T>* array = Array<T>();
+        return array ? array->Get(entity) : nullptr;
+    }
+
+    /**
+     * \brief Call Start on every stored component
+     */
+    void Start()
+    {
+        PROFILE_SCOPE("ComponentStore::Start");
+        for(Transform& transform : m_transforms)
+        {
+            transform.Transform::Start();
+        }
+        for(SpriteRenderer& spriteRenderer : m_spriteRenderers)
+        {
+            spriteRenderer.SpriteRenderer::Start();
+        }
+        for(Animator& animator : m_animators)
+        {
+            animator.Animator::Start();
+        }
+    }
+
+    /**
+     * \brief Run the update systems over every stored component
+     * @param dt delta time of frames
+     */
+    void Update(int dt)
+    {
+        UpdateTransforms(dt, nullptr);
+        {
+            PROFILE_SCOPE("SpriteRenderer");
+            for(SpriteRenderer& spriteRenderer : m_spriteRenderers)
+            {
+                spriteRenderer.SpriteRenderer::Update(dt);
+            }
+        }
+        UpdateAnimators(dt, nullptr);
+    }
+
+    /**
+     * \brief Update every stored transform
+     * Bodies are synced by the physics engine after each step, so this only runs the frame logic of transforms.
+     * Each transform only touches itself, so ranges of transforms run in parallel.
+     * @param dt delta time of frames
+     * @param jobs job system to spread the work over, nullptr to run on the calling thread
+     */
+    void UpdateTransforms(int dt, JobSystem* jobs)
+    {
+        PROFILE_SCOPE("Transform");
+        ForEach(m_transforms, jobs, [dt](Transform& transform) { transform.Transform::Update(dt); });
+    }
+
+    /**
+     * \brief Advance every stored animator
+     * @param dt delta time of frames
+     * @param jobs job system to spread the work over, nullptr to run on the calling thread
+     */
+    void UpdateAnimators(int dt, JobSystem* jobs)
+    {
+        PROFILE_SCOPE("Animator");
+        ForEach(m_animators, jobs, [dt](Animator& animator) { animator.Animator::Update(dt); });
+    }
+
+    /**
+     * \brief Run the render systems over every stored component
+     */
+    void Render()
+    {
+        {
+            PROFILE_SCOPE("SpriteRenderer");
+            for(SpriteRenderer& spriteRenderer : m_spriteRenderers)
+            {
+                spriteRenderer.SpriteRenderer::Render();
+            }
+        }
+        PROFILE_SCOPE("Animator");
+        for(Animator& animator : m_animators)
+        {
+            animator.Animator::Render();
+        }
+    }
+
+private:
+    static const size_t kJobGrain = 256;///< Components per job when a system runs in parallel.
+
+    /**
+     * \brief Call a function on every component of an array, in parallel if a job system is given
+     */
+    template <typename T, typename Function>
+    static void ForEach(ComponentArray<T>& array, JobSystem* jobs, Function function)
+    {
+        T* data = array.begin();
+        if(!jobs)
+        {
+            for(size_t i = 0; i < array.Size(); ++i)
+            {
+                function(data[i]);
+            }
+            return;
+        }
+        jobs->ParallelFor(array.Size(), kJobGrain, [data, &function](size_t begin, size_t end)
+                          {
+                              for(size_t i = begin; i < end; ++i)
+                              {
+                                  function(data[i]);
+                              }
+                          });
+    }
+
+    ComponentArray<Transform> m_transforms;///< All stored transforms.
+    ComponentArray<SpriteRenderer> m_spriteRenderers;///< All stored sprite renderers.
+    ComponentArray<Animator> m_animators;///< All stored animators.
+    ComponentArray<Collider> m_colliders;///< All stored colliders.
+
+    std::vector<Entity> m_freeEntities;///< Ids of destroyed entities.
+    Entity m_nextEntity = 0;///< Next never used entity id.
+};
+
+template <>
+inline ComponentArray<Transform>* ComponentStore::Array<Transform>()
+{
+    return &m_transforms;
+}
+
+template <>
+inline ComponentArray<SpriteRenderer>* ComponentStore::Array<SpriteRenderer>()
+{
+    return &m_spriteRenderers;
+}
+
+template <>
+inline ComponentArray<Animator>* ComponentStore::Array<Animator>()
+{
+    return &m_animators;
+}
+
+template <>
+inline ComponentArray<Collider>* ComponentStore::Array<Collider>()
+{
+    return &m_colliders;
+}
+
+#endif /* ComponentStore_hpp */
@@ -0,0 +1,225 @@
+#ifndef ContactCache_hpp
+#define ContactCache_hpp
+
+#include <box2d/box2d.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "Collider.hpp"
+
+/**
+ * @enum ContactEventType
+ * @brief kind of change of a contact during a physics step
+ */
+enum class ContactEventType
+{
+    Begin,///the two objects started touching
+    End///the two objects stopped touching
+};
+
+/**
+ * @struct ContactEvent
+ * @brief a contact that began or ended during a physics step
+ * @details The objects are raw pointers: PhysicsEngine::RemoveGameObject purges the events of an object before it
+ * is released, so a queued event never outlives its objects. An end event keeps its surviving side: the removed
+ * side becomes nullptr, and the survivor gets its exit callback with a null other.
+ */
+struct ContactEvent
+{
+    ContactEventType type = ContactEventType::Begin;
+    GameObject* a = nullptr;
+    GameObject* b = nullptr;
+    bool aIsSensor = false;///< whether the fixture of a is a sensor
+    bool bIsSensor = false;///< whether the fixture of b is a sensor
+};
+
+/**
+ * @class ContactCache
+ * @brief Records the contacts of every object once per physics step.
+ * @details box2d reports begin and end events through the listener while the world is locked, so they are only
+ * queued and handed to scripts after the step. The touching contacts are then gathered once into a flat array
+ * sorted by owner, and queries return a view into it. Buffers keep their capacity between steps, so a steady
+ * state step allocates nothing.
+ */
+class ContactCache : public b2ContactListener
+{
+public:
+    /**
+     * \brief queue a begin event, called by box2d during the step
+     */
+    void BeginContact(b2Contact* contact) override;
+    /**
+     * \brief queue an end event, called by box2d during the step
+     */
+    void EndContact(b2Contact* contact) override;
+
+    /**
+     * \brief Gather the touching contacts of the world after a step
+     * Calls Clear, AddContact for both sides of every touching contact, then Finish.
+     *
+     * @param world stepped world
+     */
+    void Rebuild(b2World* world);
+
+    /**
+     * \brief Forget the contacts of the previous step, keeping the events
+     */
+    void Clear()
+    {
+        m_records.clear();
+        m_contacts.clear();
+    }
+
+    /**
+     * \brief Record that an object touches another
+     *
+     * @param self object the contact belongs to
+     * @param contact contact seen from self
+     * @param withSensor whether the other fixture is a sensor
+     */
+    void AddContact(GameObject* self, Contact const& contact, bool withSensor)
+    {
+        Record record;
+        record.self = self;
+        record.withSensor = withSensor;
+        record.contact = contact;
+        m_records.push_back(record);
+    }
+
+    /**
+     * \brief Sort the recorded contacts by owner so they can be queried
+     */
+    void Finish()
+    {
+        std::sort(m_records.begin(), m_records.end(), Less);
+        m_contacts.clear();
+        for(Record const& record : m_records)
+        {
+            m_contacts.push_back(record.contact);
+        }
+    }
+
+    /**
+     * \brief Get the contacts of an object in the last step
+     *
+     * @param self owner of the contacts
+     * @param withSensor true for contacts with sensors, false for the others
+     * @return view of the contacts, valid until the next step
+     */
+    ContactSpan Find(GameObject* self, bool withSensor) const
+    {
+        Record key;
+        key.self = self;
+        key.withSensor = withSensor;
+        auto range = std::equal_range(m_records.begin(), m_records.end(), key, Less);
+        ContactSpan span;
+        if(range.first != range.second)
+        {
+            span.first = m_contacts.data() + (range.first - m_records.begin());
+            span.last = m_contacts.data() + (range.second - m_records.begin());
+        }
+        return span;
+    }
+
+    /**
+     * \brief Take the events queued during the last step
+     *
+     * @param events filled with the events, previous content is dropped
+     */
+    void TakeEvents(std::vector<ContactEvent>& events)
+    {
+        events.swap(m_events);
+        m_events.clear();
+    }
+
+    /**
+     * \brief Stop delivering events to an object that is being removed
+     * Its begin events are dropped. Its end events, like those box2d fires when its body is destroyed, are kept
+     * with its side set to nullptr, so the objects it touched still get their exit callback. An end event whose
+     * begin event is still queued is dropped with it, since the other object never got the enter callback.
+     *
+     * @param gameObject object being removed
+     * @return number of events dropped or changed
+     */
+    size_t PurgeEvents(GameObject* gameObject)
+    {
+        // An end event whose begin event is still queued is marked by pointing both sides at the object.
+        for(size_t i = 0; i < m_events.size(); ++i)
+        {
+            ContactEvent& end = m_events[i];
+            if(end.type != ContactEventType::End || (end.a != gameObject && end.b != gameObject))
+            {
+                continue;
+            }
+            for(size_t j = 0; j < i; ++j)
+            {
+                ContactEvent const& begin = m_events[j];
+                if(begin.type == ContactEventType::Begin
+                   && ((begin.a == end.a && begin.b == end.b) || (begin.a == end.b && begin.b == end.a)))
+                {
+                    end.a = gameObject;
+                    end.b = gameObject;
+                    break;
+                }
+            }
+        }
+        size_t changed = 0;
+        size_t kept = 0;
+        for(size_t i = 0; i < m_events.size(); ++i)
+        {
+            ContactEvent event = m_events[i];
+            if(event.a != gameObject && event.b != gameObject)
+            {
+                m_events[kept++] = event;
+                continue;
+            }
+            ++changed;
+            if(event.type == ContactEventType::Begin || event.a == event.b)
+            {
+                continue;
+            }
+            if(event.a == gameObject)
+            {
+                event.a = nullptr;
+            }
+            else
+            {
+                event.b = nullptr;
+            }
+            m_events[kept++] = event;
+        }
+        m_events.resize(kept);
+        return changed;
+    }
+
+private:
+    /**
+     * @struct Record
+     * @brief a contact with the object it belongs to
+     */
+    struct Record
+    {
+        GameObject* self = nullptr;
+        bool withSensor = false;
+        Contact contact;
+    };
+
+    /**
+     * \brief order of records: by owner, then contacts with sensors last
+     */
+    static bool Less(Record const& a, Record const& b)
+    {
+        if(a.self != b.self)
+        {
+            return std::less<GameObject*>()(a.self, b.self);
+        }
+        return a.withSensor < b.withSensor;
+    }
+
+    std::vector<Record> m_records;///< contacts of the last step, sorted by owner after Finish
+    std::vector<Contact> m_contacts;///< contacts in the same order as m_records, what spans point into
+    std::vector<ContactEvent> m_events;///< begin and end events of the current step
+};
+
+#endif /* ContactCache_hpp */
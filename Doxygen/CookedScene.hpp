@@ -0,0 +1,610 @@
+#ifndef CookedScene_hpp
+#define CookedScene_hpp
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief First four bytes of a cooked scene, "UBSC" read as a little-endian integer.
+ */
+const uint32_t kCookedSceneMagic = 0x43534255u;
+
+/**
+ * @brief Version of the cooked scene layout, raised whenever a struct below changes.
+ */
+const uint32_t kCookedSceneVersion = 1;
+
+/**
+ * @struct CookedRange
+ * @brief An array inside the file: byte offset from the start of the file and number of elements.
+ */
+struct CookedRange
+{
+    uint64_t offset = 0;
+    uint64_t count = 0;
+};
+
+/**
+ * @struct CookedString
+ * @brief A string inside the string blob, always followed by a terminating zero.
+ */
+struct CookedString
+{
+    uint32_t offset = 0;///< Byte offset in the string blob.
+    uint32_t length = 0;///< Length without the terminating zero.
+};
+
+/**
+ * @struct CookedTileMap
+ * @brief A tile map, its tiles are mapCol * mapRow int32 values row by row starting at firstTile.
+ */
+struct CookedTileMap
+{
+    CookedString sheetPath;///< Picture of the tile sheet.
+    int32_t tileWidth = 0;
+    int32_t tileHeight = 0;
+    int32_t sheetCol = 0;
+    int32_t sheetRow = 0;
+    int32_t mapCol = 0;
+    int32_t mapRow = 0;
+    uint64_t firstTile = 0;///< Index of the first tile in the tile array.
+};
+
+/**
+ * @enum CookedObjectFlags
+ * @brief Bits of CookedObject::flags.
+ */
+enum CookedObjectFlags
+{
+    kCookedObjectStatic = 1,///< Immovable body, created with Engine::CreateStaticObject.
+    kCookedObjectSensor = 2,///< The collider is a trigger.
+    kCookedObjectNoBody = 4///< The object is not added to the physical world.
+};
+
+/**
+ * @struct CookedObject
+ * @brief Definition of a game object of the scene.
+ */
+struct CookedObject
+{
+    CookedString name;
+    CookedString tag;
+    CookedString scriptPath;///< Empty if the object has no script.
+    CookedString spritePath;///< Empty if the object has no sprite.
+    float x = 0.0f;
+    float y = 0.0f;
+    float width = 0.0f;
+    float height = 0.0f;
+    uint32_t flags = 0;///< CookedObjectFlags.
+    uint32_t animationSet = 0xFFFFFFFFu;///< Index of its animation set, 0xFFFFFFFF if it is not animated.
+};
+
+/**
+ * @struct CookedAnimationSet
+ * @brief The animations of one sprite sheet, from one animation file.
+ */
+struct CookedAnimationSet
+{
+    CookedString name;///< Path of the animation file it was cooked from.
+    CookedString sheetPath;///< Picture of the sprite sheet.
+    int32_t spriteWidth = 0;
+    int32_t spriteHeight = 0;
+    int32_t sheetCol = 0;
+    int32_t sheetRow = 0;
+    uint32_t firstClip = 0;///< Index of its first clip in the clip array.
+    uint32_t clipCount = 0;
+};
+
+/**
+ * @struct CookedClip
+ * @brief One animation: a range of frames of the sprite sheet.
+ */
+struct CookedClip
+{
+    CookedString name;
+    int32_t startFrame = 0;
+    int32_t lastFrame = 0;
+    int32_t fps = 0;
+    int32_t padding = 0;
+};
+
+/**
+ * @struct CookedSceneHeader
+ * @brief Start of a cooked scene file. Every range is 8-byte aligned.
+ */
+struct CookedSceneHeader
+{
+    uint32_t magic = kCookedSceneMagic;
+    uint32_t version = kCookedSceneVersion;
+    uint64_t fileSize = 0;
+    CookedRange strings;///< char
+    CookedRange tileMaps;///< CookedTileMap
+    CookedRange tiles;///< int32_t
+    CookedRange objects;///< CookedObject
+    CookedRange animationSets;///< CookedAnimationSet
+    CookedRange clips;///< CookedClip
+};
+
+/**
+ * @class CookedSceneWriter
+ * @brief Collects the contents of a scene and writes them as a cooked scene file.
+ * @details This is the offline side: the cook step reads the scene json, the tile csv and the animation json once
+ * and fills a writer, so the game never parses them again.
+ */
+class CookedSceneWriter
+{
+public:
+    /**
+     * \brief Constructor, the blob starts with the empty string so a default CookedString is empty
+     */
+    CookedSceneWriter()
+    : m_strings(1, '\0')
+    {
+    }
+
+    /**
+     * \brief Copy a string into the string blob
+     * @param text string to add
+     * @return reference to the copy
+     */
+    CookedString AddString(std::string const& text)
+    {
+        CookedString string;
+        string.offset = static_cast<uint32_t>(m_strings.size());
+        string.length = static_cast<uint32_t>(text.size());
+        m_strings.insert(m_strings.end(), text.begin(), text.end());
+        m_strings.push_back('\0');
+        return string;
+    }
+
+    /**
+     * \brief Add a tile map
+     * @param map description of the map, firstTile is filled in
+     * @param tiles mapCol * mapRow tiles, row by row
+     * @return index of the map
+     */
+    uint32_t AddTileMap(CookedTileMap map, std::vector<int32_t> const& tiles)
+    {
+        map.firstTile = m_tiles.size();
+        m_tiles.insert(m_tiles.end(), tiles.begin(), tiles.end());
+        m_tileMaps.push_back(map);
+        return static_cast<uint32_t>(m_tileMaps.size() - 1);
+    }
+
+    /**
+     * \brief Add an animation set
+     * @param set description of the set, firstClip and clipCount are filled in
+     * @param clips animations of the set
+     * @return index of the set, to put in CookedObject::animationSet
+     */
+    uint32_t AddAnimationSet(CookedAnimationSet set, std::vector<CookedClip> const& clips)
+    {
+        set.firstClip = static_cast<uint32_t>(m_clips.size());
+        set.clipCount = static_cast<uint32_t>(clips.size());
+        m_clips.insert(m_clips.end(), clips.begin(), clips.end());
+        m_animationSets.push_back(set);
+        return static_cast<uint32_t>(m_animationSets.size() - 1);
+    }
+
+    /**
+     * \brief Add a game object
+     * @param object definition of the object
+     */
+    void AddObject(CookedObject const& object)
+    {
+        m_objects.push_back(object);
+    }
+
+    /**
+     * \brief Write the cooked scene
+     * @param path file to write
+     * @return false if the file could not be written
+     */
+    bool Write(std::string const& path) const
+    {
+        CookedSceneHeader header;
+        std::vector<char> data(sizeof(CookedSceneHeader));
+        header.strings = Append(data, m_strings);
+        header.tileMaps = Append(data, m_tileMaps);
+        header.tiles = Append(data, m_tiles);
+        header.objects = Append(data, m_objects);
+        header.animationSets = Append(data, m_animationSets);
+        header.clips = Append(data, m_clips);
+        header.fileSize = data.size();
+        std::memcpy(data.data(), &header, sizeof(header));
+
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if(!file)
+        {
+            std::printf("Could not write the cooked scene %s\n", path.c_str());
+            return false;
+        }
+        bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        written = std::fclose(file) == 0 && written;
+        return written;
+    }
+
+private:
+    /**
+     * \brief Append an array at the next 8-byte boundary
+     */
+    template <typename T>
+    static CookedRange Append(std::vector<char>& data, std::vector<T> const& items)
+    {
+        data.resize((data.size() + 7) & ~size_t(7), 0);
+        CookedRange range;
+        range.offset = data.size();
+        range.count = items.size();
+        if(!items.empty())
+        {
+            data.resize(data.size() + items.size() * sizeof(T));
+            std::memcpy(data.data() + range.offset, items.data(), items.size() * sizeof(T));
+        }
+        return range;
+    }
+
+    std::vector<char> m_strings;///< All strings, zero terminated.
+    std::vector<CookedTileMap> m_tileMaps;///< All tile maps.
+    std::vector<int32_t> m_tiles;///< Tiles of all maps.
+    std::vector<CookedObject> m_objects;///< All game objects.
+    std::vector<CookedAnimationSet> m_animationSets;///< All animation sets.
+    std::vector<CookedClip> m_clips;///< Clips of all sets.
+};
+
+/**
+ * \brief Read a tile csv for cooking
+ * @param path path of the csv file, one row of comma separated tile numbers per line
+ * @param tiles tiles row by row
+ * @param mapCol set to the number of columns
+ * @param mapRow set to the number of rows
+ * @return false if the file could not be read or its rows differ in length
+ */
+inline bool ReadTileCsv(std::string const& path, std::vector<int32_t>& tiles, int32_t& mapCol, int32_t& mapRow)
+{
+    std::ifstream file(path);
+    if(!file)
+    {
+        std::printf("Could not read the tile map %s\n", path.c_str());
+        return false;
+    }
+    tiles.clear();
+    mapCol = 0;
+    mapRow = 0;
+    std::string line;
+    while(std::getline(file, line))
+    {
+        if(line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+        std::stringstream row(line);
+        std::string cell;
+        int32_t count = 0;
+        while(std::getline(row, cell, ','))
+        {
+            tiles.push_back(static_cast<int32_t>(std::atoi(cell.c_str())));
+            ++count;
+        }
+        if(mapRow > 0 && count != mapCol)
+        {
+            std::printf("Row %d of %s has %d tiles instead of %d\n", mapRow, path.c_str(), count, mapCol);
+            return false;
+        }
+        mapCol = count;
+        ++mapRow;
+    }
+    return true;
+}
+
+/**
+ * @class CookedScene
+ * @brief A cooked scene file mapped into memory.
+ * @details The arrays are used in place, straight from the mapping, so opening a scene costs the checks of the
+ * header only and the pages are read by the system as they are touched. Pointers returned by the accessors stay
+ * valid until the scene is closed or destroyed.
+ */
+class CookedScene
+{
+public:
+    CookedScene() {}
+
+    CookedScene(CookedScene const&) = delete;
+    CookedScene& operator=(CookedScene const&) = delete;
+
+    ~CookedScene()
+    {
+        Close();
+    }
+
+    /**
+     * \brief Map a cooked scene file and check its header
+     * @param path file to open
+     * @return false if the file could not be mapped, is not a cooked scene, has another version or is truncated
+     */
+    bool Open(std::string const& path)
+    {
+        Close();
+        if(!Map(path))
+        {
+            std::printf("Could not map the cooked scene %s\n", path.c_str());
+            return false;
+        }
+        if(!Validate())
+        {
+            std::printf("%s is not a cooked scene of version %u\n", path.c_str(), kCookedSceneVersion);
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * \brief Unmap the file
+     */
+    void Close()
+    {
+#if defined(_WIN32)
+        if(m_data)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        if(m_mapping)
+        {
+            CloseHandle(m_mapping);
+        }
+        m_mapping = nullptr;
+#else
+        if(m_data)
+        {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    /**
+     * \brief Whether a scene is open
+     */
+    bool IsOpen() const
+    {
+        return m_data != nullptr;
+    }
+
+    /**
+     * \brief Get a string of the scene
+     * @param string reference from one of the structs
+     * @return zero terminated string, inside the mapping
+     */
+    const char* GetString(CookedString const& string) const
+    {
+        return Array<char>(Header().strings) + string.offset;
+    }
+
+    /**
+     * \brief Number of tile maps
+     */
+    size_t GetTileMapCount() const
+    {
+        return static_cast<size_t>(Header().tileMaps.count);
+    }
+
+    /**
+     * \brief Get a tile map
+     * @param index index of the map
+     */
+    CookedTileMap const& GetTileMap(size_t index) const
+    {
+        return Array<CookedTileMap>(Header().tileMaps)[index];
+    }
+
+    /**
+     * \brief Get the tiles of a map, mapCol * mapRow values row by row
+     * @param map map from GetTileMap
+     */
+    const int32_t* GetTiles(CookedTileMap const& map) const
+    {
+        return Array<int32_t>(Header().tiles) + map.firstTile;
+    }
+
+    /**
+     * \brief Number of game objects
+     */
+    size_t GetObjectCount() const
+    {
+        return static_cast<size_t>(Header().objects.count);
+    }
+
+    /**
+     * \brief Get the definition of a game object
+     * @param index index of the object
+     */
+    CookedObject const& GetObjectDefinition(size_t index) const
+    {
+        return Array<CookedObject>(Header().objects)[index];
+    }
+
+    /**
+     * \brief Number of animation sets
+     */
+    size_t GetAnimationSetCount() const
+    {
+        return static_cast<size_t>(Header().animationSets.count);
+    }
+
+    /**
+     * \brief Get an animation set
+     * @param index index of the set
+     */
+    CookedAnimationSet const& GetAnimationSet(size_t index) const
+    {
+        return Array<CookedAnimationSet>(Header().animationSets)[index];
+    }
+
+    /**
+     * \brief Get the clips of an animation set, clipCount of them
+     * @param set set from GetAnimationSet
+     */
+    const CookedClip* GetClips(CookedAnimationSet const& set) const
+    {
+        return Array<CookedClip>(Header().clips) + set.firstClip;
+    }
+
+private:
+    CookedSceneHeader const& Header() const
+    {
+        return *reinterpret_cast<CookedSceneHeader const*>(m_data);
+    }
+
+    template <typename T>
+    const T* Array(CookedRange const& range) const
+    {
+        return reinterpret_cast<const T*>(m_data + range.offset);
+    }
+
+    /**
+     * \brief Whether an array lies inside the file and is aligned for its type
+     */
+    template <typename T>
+    bool RangeFits(CookedRange const& range) const
+    {
+        return range.offset % alignof(T) == 0 && range.offset <= m_size
+            && range.count <= (m_size - range.offset) / sizeof(T);
+    }
+
+    /**
+     * \brief Check the header and that every reference stays inside the file
+     */
+    bool Validate() const
+    {
+        if(m_size < sizeof(CookedSceneHeader))
+        {
+            return false;
+        }
+        CookedSceneHeader const& header = Header();
+        if(header.magic != kCookedSceneMagic || header.version != kCookedSceneVersion || header.fileSize != m_size
+           || !RangeFits<char>(header.strings) || !RangeFits<CookedTileMap>(header.tileMaps)
+           || !RangeFits<int32_t>(header.tiles) || !RangeFits<CookedObject>(header.objects)
+           || !RangeFits<CookedAnimationSet>(header.animationSets) || !RangeFits<CookedClip>(header.clips))
+        {
+            return false;
+        }
+        const char* strings = Array<char>(header.strings);
+        uint64_t stringSize = header.strings.count;
+        auto stringFits = [strings, stringSize](CookedString const& string)
+        {
+            return static_cast<uint64_t>(string.offset) + string.length < stringSize
+                && strings[string.offset + string.length] == '\0';
+        };
+        for(size_t i = 0; i < header.tileMaps.count; ++i)
+        {
+            CookedTileMap const& map = Array<CookedTileMap>(header.tileMaps)[i];
+            if(!stringFits(map.sheetPath) || map.mapCol < 0 || map.mapRow < 0 || map.firstTile > header.tiles.count
+               || static_cast<uint64_t>(map.mapCol) * static_cast<uint64_t>(map.mapRow) > header.tiles.count - map.firstTile)
+            {
+                return false;
+            }
+        }
+        for(size_t i = 0; i < header.objects.count; ++i)
+        {
+            CookedObject const& object = Array<CookedObject>(header.objects)[i];
+            if(!stringFits(object.name) || !stringFits(object.tag) || !stringFits(object.scriptPath)
+               || !stringFits(object.spritePath)
+               || (object.animationSet != 0xFFFFFFFFu && object.animationSet >= header.animationSets.count))
+            {
+                return false;
+            }
+        }
+        for(size_t i = 0; i < header.animationSets.count; ++i)
+        {
+            CookedAnimationSet const& set = Array<CookedAnimationSet>(header.animationSets)[i];
+            if(!stringFits(set.name) || !stringFits(set.sheetPath)
+               || static_cast<uint64_t>(set.firstClip) + set.clipCount > header.clips.count)
+            {
+                return false;
+            }
+        }
+        for(size_t i = 0; i < header.clips.count; ++i)
+        {
+            if(!stringFits(Array<CookedClip>(header.clips)[i].name))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Map(std::string const& path)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return false;
+        }
+        m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if(!m_mapping)
+        {
+            return false;
+        }
+        m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        m_size = static_cast<size_t>(size.QuadPart);
+        return m_data != nullptr;
+#else
+        int file = open(path.c_str(), O_RDONLY);
+        if(file < 0)
+        {
+            return false;
+        }
+        struct stat info;
+        if(fstat(file, &info) != 0 || info.st_size == 0)
+        {
+            close(file);
+            return false;
+        }
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if(data == MAP_FAILED)
+        {
+            return false;
+        }
+        m_data = static_cast<const char*>(data);
+        m_size = static_cast<size_t>(info.st_size);
+        return true;
+#endif
+    }
+
+    const char* m_data = nullptr;///< Start of the mapping.
+    size_t m_size = 0;///< Size of the file.
+#if defined(_WIN32)
+    HANDLE m_mapping = nullptr;///< File mapping object.
+#endif
+};
+
+#endif /* CookedScene_hpp */
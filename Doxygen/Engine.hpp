@@ -14,6 +14,8 @@
 #include <cstdio>
 #include <iostream>
 #include <vector>
+#include <thread>
+#include <mutex>
 
 #include "GraphicsEngineRenderer.hpp"
 #include "InputHandler.hpp"
@@ -25,6 +27,16 @@
 #include "PhysicsEngine.hpp"
 #include "TileMap.hpp"
 #include "ResourceManager.hpp"
+#include "ComponentStore.hpp"
+#include "ObjectPool.hpp"
+#include "FixedTimestep.hpp"
+#include "FramePipeline.hpp"
+#include "JobSystem.hpp"
+#include "SpatialHash.hpp"
+#include "Camera.hpp"
+#include "Profiler.hpp"
+#include "FrameArena.hpp"
+#include "AnimationSystem.hpp"
 
 /**
  * @class Engine
@@ -42,20 +54,60 @@ public:
     ~Engine();
     /**
      *@brief Input engine
+     *SDL_RENDER_TARGETS_RESET and SDL_RENDER_DEVICE_RESET make the tile map bake its chunks again, see TileMap::OnRenderReset.
+     *Timed in the profiler as "Engine::Input", like Update, FixedUpdate and Render under their own names.
      */
     void Input();
     /**
      *@brief Per frame update
+     *Game objects are updated first, then the systems of the component store if it is enabled.
+     *The AnimationSystem clock is advanced by dt first, which is all the animations need to move on.
+     *Physics is not stepped here, see FixedUpdate.
      */
     void Update(int dt);
+    /**
+     *@brief Run the frame graph: physics steps, then transform sync, then animators and scripts, then render submit
+     *Work inside each stage is spread over the job system; the stages themselves run in this order.
+     *The transform sync stage only interpolates the moving set of TransformSync, the steps already copied the
+     *awake bodies.
+     *@param dt delta time of frames
+     *@param physicsSteps number of fixed physics steps to run first
+     */
+    void RunFrameGraph(int dt, int physicsSteps);
+    /**
+     *@brief Step the physical world once by the fixed physics step
+     *Transforms that moved in the last step remember their position before the step so rendering can interpolate;
+     *static and sleeping objects are not visited, see TransformSync.
+     *Physics regions added with PhysicsEngine::AddRegion are stepped in parallel on the engine job system.
+     *@param step length of the step in seconds
+     */
+    void FixedUpdate(float step);
     /**
      *@brief Per frame render. Renders everything
+     *Textures loaded in the background are uploaded first, within the asset upload budget.
+     *With a main camera, only objects found in the spatial index around the camera bounds are rendered,
+     *and sprites outside the camera are dropped before they reach the render queue.
      */
     void Render();
     /**
      *@brief Main Game Loop that runs forever
+     *Each frame runs as many fixed physics steps as the elapsed time allows, up to the step cap, then
+     *interpolates the moving transforms by the leftover fraction of a step before rendering.
+     *Every iteration ends with Profiler::EndFrame, which closes the frame statistics of the profiler, then
+     *FrameArena::NextFrame, after which the frame arena of every thread is reset and data allocated in it is gone.
      */
     void MainGameLoop();
+    /**
+     *@brief Run the update of the next frame on a second thread while the current frame is drawn
+     *The main thread keeps every SDL call: it polls events, and draws the snapshots that the update thread
+     *publishes. Sprites are always submitted to a render queue in this mode, so scripts must not call SDL
+     *render functions themselves. The render thread dispatches of the resource manager and the tile map are
+     *attached to the pipeline, so asset loads, evictions and tile edits made by scripts run on the main thread
+     *with the snapshot of their frame. It should be set before MainGameLoop.
+     *When it is turned off, the update thread is joined and the commands it recorded last are run.
+     *@param enable whether to pipeline frames
+     */
+    void EnablePipelinedFrames(bool enable);
     /**
      *@brief Initialization and shutdown pattern. Explicitly call 'Start' to launch the engine
      */
@@ -69,6 +121,46 @@ public:
      *@brief Request to startup the Graphics Subsystem
      */
     void InitializeGraphicsSubSystem();
+    /**
+     *@brief Start the graphics subsystem without a window, for benchmarks and tests on machines without a display
+     *Frames are drawn by the SDL software renderer into a surface in memory, and Input no longer polls SDL events.
+     *Call it instead of InitializeGraphicsSubSystem.
+     *@param width width of the surface
+     *@param height height of the surface
+     */
+    void InitializeHeadless(int width, int height);
+    /**
+     *@brief Draw the frames on the CPU with a SoftwareRasterizer instead of the SDL renderer
+     *The tiles of the frame are spread over the engine job system, and the resource manager registers every texture
+     *it creates from now on with the rasterizer. Call it after the graphics subsystem is started, before loading.
+     *@param filter how scaled sprites are sampled
+     */
+    void EnableSoftwareRasterizer(SampleFilter filter);
+    /**
+     *@brief Whether the engine runs without a window
+     */
+    bool IsHeadless() const;
+    /**
+     *@brief Run a number of frames as fast as possible with a fixed delta time
+     *Every frame runs Input, Update, the physics steps that dt covers, Render and Profiler::EndFrame, exactly like
+     *MainGameLoop, arena reset included, but without reading the clock or waiting, so two runs with the same dt give
+     *the same simulation.
+     *@param frames number of frames to run
+     *@param dt delta time of each frame in milliseconds
+     */
+    void RunFrames(int frames, int dt);
+    /**
+     *@brief Get the SDL renderer of the graphics subsystem
+     *@return renderer, nullptr before the graphics subsystem is started
+     */
+    SDL_Renderer* GetRenderer();
+    /**
+     *@brief Get the graphics engine renderer, for its render queue and software rasterizer
+     *@return renderer, nullptr before the graphics subsystem is started
+     */
+    GraphicsEngineRenderer* GetGraphicsEngineRenderer() {
+        return m_renderer;
+    }
 
     /**
      *@brief Create a gameObject with script in the engine
@@ -78,6 +170,7 @@ public:
     
     /**
      *@brief Create an empty gameObject in the engine
+     *The object and its built-in components are taken from the engine's pools.
      */
     GameObject* CreateObject();
     
@@ -90,8 +183,22 @@ public:
     GameObject* CreateStaticObject();
     /**
      *@brief Create the tilemap
+     *Only the chunks of the map that overlap the screen are drawn each frame.
      */
     void CreateTileMap(std::string scenePath);
+    /**
+     *@brief Use a tile map built in memory, the engine takes ownership of it
+     *@param tileMap tile map to draw
+     */
+    void CreateTileMap(TileMap* tileMap);
+    /**
+     *@brief Load a scene cooked by ResourceManager::CookScene
+     *The file is memory mapped: the tile map, the game objects and their animations are created straight from the
+     *flat arrays in it, and the mapping stays open until the next scene is loaded.
+     *@param cookedPath path of the cooked scene
+     *@return false if the file is missing, not a cooked scene or of another version
+     */
+    bool LoadCookedScene(std::string const& cookedPath);
     /**
      *@brief Create the background picture
      */
@@ -115,6 +222,25 @@ public:
      * @param scale
      */
     void SetScaleFactor(float scale);
+    /**
+     * \brief Set how many times per second the physical world is stepped
+     *
+     * @param hz physics rate, 60 by default
+     */
+    void SetPhysicsRate(float hz);
+    /**
+     * \brief Set the most physics steps run in one frame
+     * Time beyond the cap is dropped, which slows the game down instead of stalling it.
+     *
+     * @param steps step cap, 5 by default
+     */
+    void SetMaxPhysicsSteps(int steps);
+    /**
+     * \brief Set how long each frame may spend uploading textures loaded in the background
+     *
+     * @param ms upload budget in milliseconds
+     */
+    void SetAssetUploadBudget(Uint32 ms);
     /**
      * /brief Halt the engine for some time
      *
@@ -159,34 +285,211 @@ public:
     
     /**
      * \brief Get a vector of game objects
+     * The vector is not copied; copy it if objects may be created while iterating.
      * @return a vector of all gameobjects
      */
-    std::vector<GameObject*> GetGameObjects() {
+    std::vector<GameObject*> const& GetGameObjects() const {
         return m_gameObjects;
     }
     
+    /**
+     * \brief Visit every game object whose transform position is within a distance of a point
+     * @param center center of the circle
+     * @param radius radius of the circle
+     * @param visit called as visit(GameObject*) for each object found
+     */
+    template <typename Visit>
+    void QueryRadius(Vector2 const& center, float radius, Visit visit) const {
+        m_spatialIndex.QueryRadius(center.x, center.y, radius, visit);
+    }
+    
+    /**
+     * \brief Visit every game object whose transform position is inside a box
+     * @param min top left corner of the box
+     * @param max bottom right corner of the box
+     * @param visit called as visit(GameObject*) for each object found
+     */
+    template <typename Visit>
+    void QueryRect(Vector2 const& min, Vector2 const& max, Visit visit) const {
+        m_spatialIndex.QueryRect(min.x, min.y, max.x, max.y, visit);
+    }
+    
+    /**
+     * \brief Find the nearest game object hit by a ray, treating each object as a circle
+     * @param origin start of the ray
+     * @param direction normalized direction of the ray
+     * @param maxDistance length of the ray
+     * @param radius radius of the circle of every object
+     * @param hit set to the object hit
+     * @param distance set to the distance to the hit
+     * @return whether an object was hit
+     */
+    bool Raycast(Vector2 const& origin, Vector2 const& direction, float maxDistance, float radius,
+                 GameObject*& hit, float& distance) const {
+        return m_spatialIndex.Raycast(origin.x, origin.y, direction.x, direction.y, maxDistance, radius, hit, distance);
+    }
+    
+    /**
+     * \brief Set the camera the world is drawn from
+     * @param camera camera component, nullptr to draw in screen coordinates without culling
+     */
+    void SetMainCamera(Camera* camera);
+    
+    /**
+     * \brief Get the camera the world is drawn from
+     * @return main camera, nullptr if there is none
+     */
+    Camera* GetMainCamera();
+    
+    /**
+     * \brief Set how far outside the camera bounds an object position may be and still be rendered
+     * It should be at least half the size of the largest sprite.
+     * @param margin distance in world units
+     */
+    void SetCullingMargin(float margin);
+
+    /**
+     * \brief Number of calls to the global allocator during the last frame
+     * Only counted in builds defining ENGINE_COUNT_ALLOCATIONS, see FrameArena.hpp; it should stay 0 once the
+     * game reached a steady state, since transient data goes to the frame arenas.
+     * @return allocations of the last frame, 0 when not counted
+     */
+    uint64_t GetFrameAllocationCount() const {
+        return m_frameAllocations;
+    }
+    
+    /**
+     * \brief Write the recent frames recorded by the profiler as a chrome://tracing / Perfetto file
+     * Per frame statistics of each scope are available from Profiler::GetInstance().GetStats.
+     * @param path file to write
+     * @return false if the file could not be written
+     */
+    bool ExportProfile(std::string const& path) {
+        return Profiler::GetInstance().ExportChromeTrace(path);
+    }
+    
+    /**
+     * \brief Set the cell size of the spatial index, close to the usual query radius
+     * It should be set before creating any game object.
+     * @param size cell size in pixels
+     */
+    void SetSpatialCellSize(float size);
+    
     /**
      * \brief Remove a game object from the engine
+     * The object stays valid until the end of the frame, when its body is removed from the physical world
+     * and its slot is recycled. It is queued through QueueDestroy, so destroying it again before then does nothing.
      * @param obj
      */
     void DestroyGameObject(GameObject* obj);
     
+    /**
+     * \brief Get a game object from its handle
+     * @param handle handle of the object
+     * @return the game object, nullptr if it has been destroyed
+     */
+    GameObject* GetGameObject(GameObjectHandle handle);
+    
     /**
      * \brief
      * @return a pointer to the physical engine
      */
     PhysicsEngine* GetPhysicalEngine();
     
+    /**
+     * \brief Store the built-in components of new game objects in packed per-type arrays
+     * It should be set before creating any game object. Objects created before keep owning their components.
+     *
+     * @param enable whether to use the component store
+     */
+    void EnableComponentStore(bool enable);
+    
+    /**
+     * \brief Get the job system shared by the engine subsystems
+     * @return a pointer to the job system
+     */
+    JobSystem* GetJobSystem();
+    
+    /**
+     * \brief Get the number of pooled game objects currently alive
+     */
+    size_t GetPooledObjectCount() const;
+    
+    /**
+     * \brief Get the component store
+     * @return a pointer to the component store, nullptr if it is not enabled
+     */
+    ComponentStore* GetComponentStore();
+    
+    /**
+     * \brief Get the animated sprites that have no game object
+     * Render submits the visible ones after the tile map, sampling their clips from the animation library of the
+     * resource manager at the current AnimationSystem time.
+     * @return the animation system
+     */
+    AnimationSystem& GetAnimationSystem() {
+        return m_animationSystem;
+    }
+    
 private:
+    /**
+     * \brief Release the objects destroyed during this frame
+     * Removes their bodies from the physical world, returns their built-in components to the pools and
+     * swaps them out of the object list, so each destruction costs O(1).
+     */
+    void FlushDestroyedGameObjects();
+    
+    /**
+     * \brief Queue an object for FlushDestroyedGameObjects, at most once
+     * @param obj object to destroy
+     * @return false if the object was already queued, and must not be released twice
+     */
+    bool QueueDestroy(GameObject* obj) {
+        if(obj->m_destroyPending) {
+            return false;
+        }
+        obj->m_destroyPending = true;
+        m_pendingDestroy.push_back(obj);
+        return true;
+    }
+    
+    /**
+     * \brief Body of the update thread when frames are pipelined
+     * Applies the events collected by the main thread, updates the game and publishes a render snapshot.
+     * Its frames are not the frames of the main loop, so its frame arena is set to manual reset and reset at the
+     * end of each of its iterations.
+     */
+    void UpdateThreadLoop();
+    
+    /**
+     * \brief Draw a snapshot published by the update thread, on the main thread
+     * Runs its commands and the background loads first, draws it, then runs its retire commands.
+     * Its sprites and culled count are swapped into the render queue of the renderer, after the update thread
+     * swapped them out of m_snapshotQueue, so the stats of the flush count the sprites culled for the frame.
+     * @param snapshot frame to draw
+     */
+    void RenderSnapshotFrame(RenderSnapshot& snapshot);
+    
+    /**
+     * \brief Move the objects in the spatial index to their transform positions after the transform sync
+     * Objects only change bucket when they cross a cell.
+     */
+    void UpdateSpatialIndex();
+    
     // Engine Subsystem
     // Setup the Graphics Rendering Engine
     
     GraphicsEngineRenderer* m_renderer = nullptr;///< Pointer to current graphics engine renderer
     
     std::vector<GameObject*> m_gameObjects;///< Vector of all game objects
+    SpatialHash<GameObject*> m_spatialIndex;///< Game objects by transform position
+    Camera* m_mainCamera = nullptr;///< Camera the world is drawn from
+    float m_cullingMargin = 128.0f;///< Extra distance around the camera bounds searched for visible objects
     
     
     TileMap* m_tileMap;///< Pointer to current scene tilemap
+    AnimationSystem m_animationSystem;///< Animated sprites without game objects
+    CookedScene m_cookedScene;///< Mapping of the current cooked scene, if it was loaded from one
     //std::vector<Component*> m_components;
     
     //bool m_kLetter[26];
@@ -195,7 +498,34 @@ private:
     
     bool quit;///< Bool to control whether to quit the main loop
 
+    JobSystem* m_jobSystem = nullptr;///< Worker threads shared by the engine subsystems
+    JobGraph m_frameGraph;///< Stages of a frame and their order
+    
+    uint64_t m_frameAllocations = 0;///< Calls to the global allocator during the last frame
+    
+    bool m_headless = false;///< Whether the graphics subsystem runs without a window
+    
+    bool m_pipelined = false;///< Whether update and render run on different threads
+    FramePipeline m_framePipeline;///< Snapshots passed from the update thread to the main thread
+    RenderQueue m_snapshotQueue;///< Queue the sprites of the update thread are submitted to
+    std::thread m_updateThread;///< Thread that updates the game when frames are pipelined
+    std::mutex m_eventMutex;///< Guards m_pendingEvents
+    std::vector<SDL_Event> m_pendingEvents;///< Events polled by the main thread, not applied yet
+    
+    FixedTimestep m_physicsClock;///< Accumulator of the fixed physics step
+    
+    Uint32 m_assetUploadBudget = 4;///< Milliseconds per frame for uploading background loaded textures
+
     PhysicsEngine* m_physicsEngine = nullptr;///< Pointer to the physics engine
+
+    ComponentStore* m_componentStore = nullptr;///< Packed storage of built-in components, nullptr if not enabled
+
+    ObjectPool<GameObject> m_gameObjectPool;///< Storage of all game objects
+    ObjectPool<Transform> m_transformPool;///< Storage of pooled transforms
+    ObjectPool<SpriteRenderer> m_spriteRendererPool;///< Storage of pooled sprite renderers
+    ObjectPool<Animator> m_animatorPool;///< Storage of pooled animators
+    ObjectPool<Collider> m_colliderPool;///< Storage of pooled colliders
+    std::vector<GameObject*> m_pendingDestroy;///< Objects destroyed during the current frame
 };
 
 #endif /* Engine_hpp */
@@ -0,0 +1,86 @@
+#ifndef FixedTimestep_hpp
+#define FixedTimestep_hpp
+
+/**
+ * @class FixedTimestep
+ * @brief Accumulator that turns variable frame times into a whole number of fixed simulation steps.
+ * @details Elapsed time is added to an accumulator and consumed in steps of 1/rate seconds. If a frame would
+ * need more than the step cap, the extra time is dropped so a spike cannot snowball into ever longer frames.
+ * The leftover fraction of a step is the alpha used to interpolate rendering between the last two states.
+ */
+class FixedTimestep
+{
+public:
+    /**
+     * \brief Constructor
+     * @param rate simulation steps per second
+     * @param maxSteps most steps run for one frame
+     */
+    explicit FixedTimestep(float rate = 60.0f, int maxSteps = 5)
+    {
+        SetRate(rate);
+        SetMaxSteps(maxSteps);
+    }
+
+    /**
+     * \brief Set the simulation rate
+     * @param rate steps per second, must be positive
+     */
+    void SetRate(float rate)
+    {
+        m_step = 1.0 / rate;
+    }
+
+    /**
+     * \brief Set the cap of steps per frame
+     * @param maxSteps most steps run for one frame, at least 1
+     */
+    void SetMaxSteps(int maxSteps)
+    {
+        m_maxSteps = maxSteps < 1 ? 1 : maxSteps;
+    }
+
+    /**
+     * \brief Add the time of a frame
+     * @param elapsed seconds since the last frame
+     * @return number of steps to run this frame
+     */
+    int Advance(double elapsed)
+    {
+        m_accumulator += elapsed;
+        int steps = static_cast<int>(m_accumulator / m_step);
+        if(steps > m_maxSteps)
+        {
+            steps = m_maxSteps;
+            m_accumulator = 0.0;
+        }
+        else
+        {
+            m_accumulator -= steps * m_step;
+        }
+        return steps;
+    }
+
+    /**
+     * \brief Length of one step in seconds
+     */
+    float GetStep() const
+    {
+        return static_cast<float>(m_step);
+    }
+
+    /**
+     * \brief How far the current time is between the last two steps, 0-1
+     */
+    float GetAlpha() const
+    {
+        return static_cast<float>(m_accumulator / m_step);
+    }
+
+private:
+    double m_step = 1.0 / 60.0;///< Seconds per step.
+    double m_accumulator = 0.0;///< Time not simulated yet.
+    int m_maxSteps = 5;///< Cap of steps per frame.
+};
+
+#endif /* FixedTimestep_hpp */
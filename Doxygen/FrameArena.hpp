@@ -0,0 +1,370 @@
+#ifndef FrameArena_hpp
+#define FrameArena_hpp
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @class FrameArena
+ * @brief Linear allocator for data that only lives until the end of the frame.
+ * @details Allocating bumps a pointer and freeing does nothing; everything is dropped at once when the arena is
+ * reset. Each thread has its own arena, from GetFrameArena, so allocating needs no lock. Arenas reset themselves
+ * on their first allocation after Engine::MainGameLoop called NextFrame, so a thread never touches the arena of
+ * another. An arena only allocates on the thread that created it, which debug builds assert. When a frame needs
+ * more than one block, the next reset replaces the blocks by a single one large enough, so after a few frames a
+ * steady frame never calls the global allocator.
+ */
+class FrameArena
+{
+public:
+    static const size_t kDefaultBlockSize = 256 * 1024;///< Size of the first block.
+
+    /**
+     * \brief Constructor, no memory is taken until the first allocation
+     * @param blockSize size of the first block
+     */
+    explicit FrameArena(size_t blockSize = kDefaultBlockSize)
+    : m_blockSize(blockSize), m_epoch(Epoch().load(std::memory_order_relaxed)), m_owner(std::this_thread::get_id())
+    {
+    }
+
+    FrameArena(FrameArena const&) = delete;
+    FrameArena& operator=(FrameArena const&) = delete;
+
+    ~FrameArena()
+    {
+        for(Block& block : m_blocks)
+        {
+            std::free(block.data);
+        }
+    }
+
+    /**
+     * \brief Get memory valid until the arena is reset
+     * @param size number of bytes
+     * @param alignment alignment of the memory, a power of two
+     * @return the memory, never nullptr
+     */
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+        assert(m_owner == std::this_thread::get_id() && "frame arena used by another thread than its owner");
+        if(!m_manualReset && m_epoch != Epoch().load(std::memory_order_relaxed))
+        {
+            Reset();
+        }
+        uintptr_t cursor = (m_cursor + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        if(m_cursor == 0 || cursor + size > m_end)
+        {
+            return AllocateSlow(size, alignment);
+        }
+        m_cursor = cursor + size;
+        return reinterpret_cast<void*>(cursor);
+    }
+
+    /**
+     * \brief Get uninitialized memory for an array
+     * @param count number of elements
+     */
+    template <typename T>
+    T* AllocateArray(size_t count)
+    {
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * \brief Drop everything allocated so far, merging the blocks into one if the frame needed several
+     */
+    void Reset()
+    {
+        m_epoch = Epoch().load(std::memory_order_relaxed);
+        if(m_blocks.size() > 1)
+        {
+            size_t total = 0;
+            for(Block& block : m_blocks)
+            {
+                total += block.size;
+                std::free(block.data);
+            }
+            m_blocks.clear();
+            m_blockSize = total;
+            AddBlock(total);
+        }
+        m_used = 0;
+        m_cursor = m_blocks.empty() ? 0 : reinterpret_cast<uintptr_t>(m_blocks.back().data);
+        m_end = m_blocks.empty() ? 0 : m_cursor + m_blocks.back().size;
+    }
+
+    /**
+     * \brief Stop resetting on NextFrame, for threads whose frames are not the frames of the main loop
+     * Such a thread calls Reset itself, like the update thread when frames are pipelined.
+     * @param manual whether the owner resets the arena itself
+     */
+    void SetManualReset(bool manual)
+    {
+        m_manualReset = manual;
+    }
+
+    /**
+     * \brief Bytes handed out since the last reset, alignment included
+     */
+    size_t GetUsed() const
+    {
+        return m_used + (m_blocks.empty() ? 0 : m_cursor - reinterpret_cast<uintptr_t>(m_blocks.back().data));
+    }
+
+    /**
+     * \brief Bytes held by the arena
+     */
+    size_t GetCapacity() const
+    {
+        size_t capacity = 0;
+        for(Block const& block : m_blocks)
+        {
+            capacity += block.size;
+        }
+        return capacity;
+    }
+
+    /**
+     * \brief Start a new frame: every arena resets before its next allocation
+     * Called by the main loop once every thread is done with the data of the frame.
+     */
+    static void NextFrame()
+    {
+        Epoch().fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    /**
+     * @struct Block
+     * @brief memory taken from the system
+     */
+    struct Block
+    {
+        char* data;
+        size_t size;
+    };
+
+    static std::atomic<uint64_t>& Epoch()
+    {
+        static std::atomic<uint64_t> epoch{0};
+        return epoch;
+    }
+
+    void* AllocateSlow(size_t size, size_t alignment)
+    {
+        if(!m_blocks.empty())
+        {
+            m_used += m_cursor - reinterpret_cast<uintptr_t>(m_blocks.back().data);
+        }
+        size_t blockSize = m_blockSize;
+        while(blockSize < size + alignment)
+        {
+            blockSize *= 2;
+        }
+        AddBlock(blockSize);
+        m_blockSize = blockSize;
+        uintptr_t cursor = (m_cursor + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        m_cursor = cursor + size;
+        return reinterpret_cast<void*>(cursor);
+    }
+
+    void AddBlock(size_t size)
+    {
+        char* data = static_cast<char*>(std::malloc(size));
+        if(!data)
+        {
+            throw std::bad_alloc();
+        }
+        m_blocks.push_back(Block{data, size});
+        m_cursor = reinterpret_cast<uintptr_t>(data);
+        m_end = m_cursor + size;
+    }
+
+    std::vector<Block> m_blocks;///< Blocks in use this frame, the last one is being filled.
+    size_t m_blockSize;///< Size of the next block.
+    size_t m_used = 0;///< Bytes used in the full blocks.
+    uintptr_t m_cursor = 0;///< Next free byte of the last block.
+    uintptr_t m_end = 0;///< End of the last block.
+    uint64_t m_epoch;///< Frame the arena was last reset in.
+    bool m_manualReset = false;///< Whether NextFrame is ignored.
+    std::thread::id m_owner;///< Thread that created the arena, the only one allowed to allocate from it.
+};
+
+/**
+ * \brief Frame arena of the calling thread
+ */
+inline FrameArena& GetFrameArena()
+{
+    static thread_local FrameArena arena;
+    return arena;
+}
+
+/**
+ * @class FrameAllocator
+ * @brief Standard allocator over a frame arena, for containers that are dropped before the frame ends.
+ * @details Containers take the arena of the thread that creates them, and must only grow on that thread: a job
+ * pushing into a frame vector of the main thread would bump the arena of the main thread concurrently with it.
+ * Jobs build their own containers, or the creator reserves the final size before handing the data out. Freeing is
+ * a no-op, so a growing vector leaves its old buffers behind until the reset; reserve when the size is known.
+ */
+template <typename T>
+class FrameAllocator
+{
+public:
+    typedef T value_type;
+
+    FrameAllocator()
+    : m_arena(&GetFrameArena())
+    {
+    }
+
+    explicit FrameAllocator(FrameArena& arena)
+    : m_arena(&arena)
+    {
+    }
+
+    template <typename U>
+    FrameAllocator(FrameAllocator<U> const& other)
+    : m_arena(other.GetArena())
+    {
+    }
+
+    T* allocate(size_t count)
+    {
+        return m_arena->AllocateArray<T>(count);
+    }
+
+    void deallocate(T*, size_t)
+    {
+    }
+
+    FrameArena* GetArena() const
+    {
+        return m_arena;
+    }
+
+    template <typename U>
+    bool operator==(FrameAllocator<U> const& other) const
+    {
+        return m_arena == other.GetArena();
+    }
+
+    template <typename U>
+    bool operator!=(FrameAllocator<U> const& other) const
+    {
+        return m_arena != other.GetArena();
+    }
+
+private:
+    FrameArena* m_arena;///< Arena the memory comes from.
+};
+
+/**
+ * @brief Vector in the frame arena.
+ */
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+/**
+ * @brief String in the frame arena.
+ */
+typedef std::basic_string<char, std::char_traits<char>, FrameAllocator<char>> FrameString;
+
+/**
+ * @brief Hash map in the frame arena.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+using FrameHashMap = std::unordered_map<Key, Value, Hash, Equal, FrameAllocator<std::pair<const Key, Value>>>;
+
+/**
+ * \brief Number of calls to the global operator new so far, aligned versions included
+ * Only counted in builds defining ENGINE_COUNT_ALLOCATIONS, where one source file must also expand
+ * ENGINE_DEFINE_ALLOCATION_COUNTER at namespace scope; 0 otherwise.
+ */
+inline std::atomic<uint64_t>& GlobalAllocationCounter()
+{
+    static std::atomic<uint64_t> count{0};
+    return count;
+}
+
+/**
+ * \brief Number of calls to the global allocator so far, 0 unless ENGINE_COUNT_ALLOCATIONS is defined
+ */
+inline uint64_t GetAllocationCount()
+{
+    return GlobalAllocationCounter().load(std::memory_order_relaxed);
+}
+
+#if defined(ENGINE_COUNT_ALLOCATIONS) && defined(__cpp_aligned_new)
+    /// Counting versions of the operator new and delete for over-aligned types, which do not call the plain ones.
+    /// The pointer given by malloc is stored right before the aligned memory.
+    #define ENGINE_DEFINE_ALIGNED_ALLOCATION_COUNTER \
+        void* operator new(std::size_t size, std::align_val_t align) \
+        { \
+            GlobalAllocationCounter().fetch_add(1, std::memory_order_relaxed); \
+            std::size_t alignment = static_cast<std::size_t>(align); \
+            if(void* raw = std::malloc(size + alignment + sizeof(void*))) \
+            { \
+                uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + alignment - 1) \
+                                    & ~static_cast<uintptr_t>(alignment - 1); \
+                reinterpret_cast<void**>(aligned)[-1] = raw; \
+                return reinterpret_cast<void*>(aligned); \
+            } \
+            throw std::bad_alloc(); \
+        } \
+        void operator delete(void* memory, std::align_val_t) noexcept \
+        { \
+            if(memory) \
+            { \
+                std::free(reinterpret_cast<void**>(memory)[-1]); \
+            } \
+        } \
+        void operator delete(void* memory, std::size_t, std::align_val_t) noexcept \
+        { \
+            if(memory) \
+            { \
+                std::free(reinterpret_cast<void**>(memory)[-1]); \
+            } \
+        }
+#else
+    #define ENGINE_DEFINE_ALIGNED_ALLOCATION_COUNTER
+#endif
+
+#if defined(ENGINE_COUNT_ALLOCATIONS)
+    /// Replace the global operator new and delete by counting versions, the aligned ones too when the language has
+    /// them. The array and nothrow versions call these. Expand in exactly one source file.
+    #define ENGINE_DEFINE_ALLOCATION_COUNTER \
+        ENGINE_DEFINE_ALIGNED_ALLOCATION_COUNTER \
+        void* operator new(std::size_t size) \
+        { \
+            GlobalAllocationCounter().fetch_add(1, std::memory_order_relaxed); \
+            if(void* memory = std::malloc(size ? size : 1)) \
+            { \
+                return memory; \
+            } \
+            throw std::bad_alloc(); \
+        } \
+        void operator delete(void* memory) noexcept \
+        { \
+            std::free(memory); \
+        } \
+        void operator delete(void* memory, std::size_t) noexcept \
+        { \
+            std::free(memory); \
+        }
+#else
+    #define ENGINE_DEFINE_ALLOCATION_COUNTER
+#endif
+
+#endif /* FrameArena_hpp */
@@ -0,0 +1,251 @@
+#ifndef FramePipeline_hpp
+#define FramePipeline_hpp
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#elif defined(__APPLE__)
+    #include <SDL2/SDL.h>
+#else
+    #include <SDL.h>
+#endif
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "RenderQueue.hpp"
+
+/**
+ * @brief Work that must run on the render thread, recorded by another thread.
+ */
+typedef std::function<void()> RenderCommand;
+
+/**
+ * @struct RenderSnapshot
+ * @brief Everything the render thread needs to draw one frame, produced by the update thread.
+ * @details Besides the sprites, a snapshot carries the render thread work recorded while it was built: loads and
+ * tile edits run before its sprites are drawn, and frees run once it is drawn. Snapshots are drawn in order, so
+ * by then every older snapshot is retired, and the newer ones were built after the freed assets were released.
+ */
+struct RenderSnapshot
+{
+    std::vector<SpriteCommand> sprites;///< Sprites of the frame, in submission order.
+    std::vector<RenderCommand> commands;///< Render thread work of the frame, run before the sprites are drawn.
+    std::vector<RenderCommand> retireCommands;///< Frees of the frame, run once the snapshot is drawn.
+    int culled = 0;///< Sprites culled on the update thread, added to the stats of the flush that draws them.
+    SDL_Rect viewport{0, 0, 0, 0};///< Visible part of the world, used to draw the tile map.
+    uint64_t frame = 0;///< Number of the frame that produced the snapshot.
+
+    /**
+     * \brief Run a list of commands in order and empty it. Render thread only.
+     * @param list commands or retireCommands
+     */
+    static void Run(std::vector<RenderCommand>& list)
+    {
+        for(RenderCommand& command : list)
+        {
+            command();
+        }
+        list.clear();
+    }
+};
+
+/**
+ * @class FramePipeline
+ * @brief Hands render snapshots from the update thread to the render thread.
+ * @details Three snapshots rotate between the two threads: one being built, one published and one being drawn,
+ * so the update of frame N+1 runs while frame N is drawn. Publishing waits until the render thread took the
+ * previous snapshot, which keeps the update thread at most one frame ahead and never drops a frame.
+ * Snapshots are reused, so their vectors keep their capacity.
+ */
+class FramePipeline
+{
+public:
+    /**
+     * \brief Get the snapshot to fill for the next frame. Update thread only.
+     * @return snapshot that neither the render thread nor the published slot uses
+     */
+    RenderSnapshot& BeginBuild()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(int i = 0; i < kSnapshotCount; ++i)
+        {
+            if(i != m_published && i != m_drawing)
+            {
+                m_building = i;
+                break;
+            }
+        }
+        return m_snapshots[m_building];
+    }
+
+    /**
+     * \brief Record render thread work in the frame being built. Any thread but the render thread.
+     * @param command work to run
+     * @param retire false to run it before the frame is drawn, true to run it once the frame is drawn
+     */
+    void Record(RenderCommand command, bool retire)
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        (retire ? m_pendingRetire : m_pendingCommands).push_back(std::move(command));
+    }
+
+    /**
+     * \brief Hand the built snapshot to the render thread. Update thread only.
+     * Waits while the previous snapshot has not been taken yet, then moves the commands recorded since the last
+     * publish into the snapshot.
+     * @return false if the pipeline was stopped
+     */
+    bool Publish()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_stopped || m_published < 0; });
+        if(m_stopped)
+        {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> commandLock(m_commandMutex);
+            RenderSnapshot& snapshot = m_snapshots[m_building];
+            snapshot.commands.swap(m_pendingCommands);
+            snapshot.retireCommands.swap(m_pendingRetire);
+            m_pendingCommands.clear();
+            m_pendingRetire.clear();
+        }
+        m_published = m_building;
+        m_building = -1;
+        m_condition.notify_all();
+        return true;
+    }
+
+    /**
+     * \brief Take the published snapshot. Render thread only.
+     * Waits until the update thread publishes one.
+     * @return the snapshot, nullptr if the pipeline was stopped
+     */
+    RenderSnapshot* Acquire()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_stopped || m_published >= 0; });
+        if(m_published < 0)
+        {
+            return nullptr;
+        }
+        m_drawing = m_published;
+        m_published = -1;
+        m_condition.notify_all();
+        return &m_snapshots[m_drawing];
+    }
+
+    /**
+     * \brief Give back the snapshot taken by Acquire. Render thread only.
+     */
+    void Release()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_drawing = -1;
+    }
+
+    /**
+     * \brief Wake and stop both threads
+     */
+    void Stop()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+        m_condition.notify_all();
+    }
+
+    /**
+     * \brief Run the commands recorded after the last publish. Render thread only, once the update thread stopped.
+     */
+    void RunPending()
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        RenderSnapshot::Run(m_pendingCommands);
+        RenderSnapshot::Run(m_pendingRetire);
+    }
+
+    /**
+     * \brief Make the pipeline usable again after Stop
+     */
+    void Reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = false;
+        m_building = -1;
+        m_published = -1;
+        m_drawing = -1;
+    }
+
+private:
+    static const int kSnapshotCount = 3;///< Built, published and drawn.
+
+    RenderSnapshot m_snapshots[kSnapshotCount];///< Rotating snapshots.
+    int m_building = -1;///< Snapshot owned by the update thread.
+    int m_published = -1;///< Snapshot waiting for the render thread.
+    int m_drawing = -1;///< Snapshot owned by the render thread.
+    bool m_stopped = false;///< Set by Stop.
+
+    std::mutex m_mutex;///< Guards the indices.
+    std::condition_variable m_condition;///< Signals publish, acquire and stop.
+
+    std::mutex m_commandMutex;///< Guards the pending commands, recorded from any thread.
+    std::vector<RenderCommand> m_pendingCommands;///< Commands recorded since the last publish.
+    std::vector<RenderCommand> m_pendingRetire;///< Retire commands recorded since the last publish.
+};
+
+/**
+ * @class RenderThreadDispatch
+ * @brief Sends work that touches SDL or render thread state to the render thread when frames are pipelined.
+ * @details Owners such as ResourceManager and TileMap call Defer first in functions that must run on the render
+ * thread; it records the call in the frame being built when the caller is another thread, and returns false
+ * when the call may go on right away.
+ */
+class RenderThreadDispatch
+{
+public:
+    /**
+     * \brief Start recording calls from other threads. Render thread only.
+     * @param pipeline pipeline of the frames the calls are recorded in
+     */
+    void Attach(FramePipeline* pipeline)
+    {
+        m_renderThread = std::this_thread::get_id();
+        m_pipeline = pipeline;
+    }
+
+    /**
+     * \brief Run every call right away again
+     */
+    void Detach()
+    {
+        m_pipeline = nullptr;
+    }
+
+    /**
+     * \brief Record a call if it is not made on the render thread
+     * @param command the call, made again on the render thread
+     * @param retire whether it frees something older snapshots may draw, see RenderSnapshot
+     * @return true if the call was recorded and the caller must return
+     */
+    bool Defer(RenderCommand command, bool retire = false)
+    {
+        if(!m_pipeline || std::this_thread::get_id() == m_renderThread)
+        {
+            return false;
+        }
+        m_pipeline->Record(std::move(command), retire);
+        return true;
+    }
+
+private:
+    FramePipeline* m_pipeline = nullptr;///< Pipeline calls are recorded in, nullptr when not pipelined.
+    std::thread::id m_renderThread;///< Thread that owns the renderer.
+};
+
+#endif /* FramePipeline_hpp */
@@ -24,6 +24,14 @@
 #include "Collider.hpp"
 #include "ResourceManager.hpp"
 #include "PhysicsEngine.hpp"
+#include "ComponentStore.hpp"
+#include "ObjectPool.hpp"
+#include "SpatialHash.hpp"
+
+/**
+ * @brief Generation-checked handle of a pooled game object.
+ */
+typedef PoolHandle GameObjectHandle;
 
 /**
  * @class GameObject
@@ -40,6 +48,14 @@ public:
      */
     GameObject(SDL_Renderer* renderer, PhysicsEngine* physicsEngine);
     
+    /**
+     * \brief Constructor of a game object whose built-in components live in a component store
+     * @param *renderer current renderer
+     * @param *physicsEngine current physics engine
+     * @param *store component store that owns the Transform, SpriteRenderer, Animator and Collider of this object
+     */
+    GameObject(SDL_Renderer* renderer, PhysicsEngine* physicsEngine, ComponentStore* store);
+    
     ~GameObject();
     
     /**
@@ -49,12 +65,16 @@ public:
     
     /**
      * \brief called every frame
+     * When the object lives in a component store, only the components that are not stored there are updated here.
+     * Each component is timed in the profiler under its GetName().
      * @param dt delta time of frames
      */
     void Update(int dt);
     
     /**
      * @brief Draw the object
+     * When the object lives in a component store, only the components that are not stored there are rendered here.
+     * Each component is timed in the profiler under its GetName().
      */
     void Render();
     
@@ -70,6 +90,12 @@ public:
      */
     void SetRenderer(SDL_Renderer* renderer);
     
+    /**
+     * \brief Set the render queue of the sprite renderer and animator of this object
+     * @param queue target render queue, nullptr to draw immediately
+     */
+    void SetRenderQueue(RenderQueue* queue);
+    
     /**
      *@brief whether the gameObject is destroyed
      */
@@ -77,34 +103,69 @@ public:
     //--------------exposed to uesrs--------------
     /**
      *@brief add component to this gameObject
+     *When the object lives in a component store, built-in components are copied into the store and the passed instance is deleted.
+     *The component is registered for GetComponent under component->GetTypeId(): a class that does not override it
+     *is only found by GetComponent when added through the typed AddComponent.
      *@param component compoenet
      */
     void AddComponent(Component* component);
     /**
-     *@brief Destroy a gameObject, but not release the memory until game ends
+     *@brief add component to this gameObject and register it for GetComponent
+     *@param component compoenet
+     *@return the added component, or its copy in the component store
+     */
+    template <typename T>
+    T* AddComponent(T* component)
+    {
+        AddComponent(static_cast<Component*>(component));
+        if(m_store && m_store->Array<T>())
+        {
+            return m_store->Get<T>(m_entity);
+        }
+        RegisterComponent(component, ComponentTypeRegistry::GetId<T>());
+        return component;
+    }
+    /**
+     *@brief Destroy a gameObject. The engine recycles its memory at the end of the frame
      */
     void Destroy();
     /**
      *@brief get a certain type of component from this gameObject
+     *When the object lives in a component store, a built-in component is returned from its packed array: the pointer
+     *is only valid until a component of the same type is added to or removed from the store. Keep the game object, or
+     *its handle, and call GetComponent again instead of keeping the pointer across frames.
+     *The lookup is an index into the slot table of the object, without RTTI: a component is found if it was added
+     *through the typed AddComponent, or if its class overrides GetTypeId with ComponentTypeRegistry::GetId.
+     *It returns a pointer where it used to return a reference, which dangled when the component was missing.
+     *@return pointer to the component, nullptr if the gameObject has no component of this type
      */
     template <typename T>
-    T& GetComponent()
+    T* GetComponent()
     {
-        T* t = nullptr;
-        for(Component* component : m_components)
+        if(m_store)
         {
-            if(typeid( dynamic_cast<T*>(component)).name() == typeid(T*).name())
+            ComponentArray<T>* array = m_store->Array<T>();
+            if(array)
             {
-                //return dynamic_cast<T*>(&component);
-                t = dynamic_cast<T*>(component);
-                break;
+                return array->Get(m_entity);
             }
         }
-        return *t;
+        ComponentTypeId id = ComponentTypeRegistry::GetId<T>();
+        return id < m_componentSlots.size() ? static_cast<T*>(m_componentSlots[id]) : nullptr;
+    }
+    /**
+     *@brief whether this gameObject has a certain type of component
+     */
+    template <typename T>
+    bool HasComponent()
+    {
+        return GetComponent<T>() != nullptr;
     }
     
     /**
      * \brief Get transform component of current object
+     * When the object lives in a component store, the pointer is only valid until a transform is added or removed.
+     * The same applies to the other built-in component getters.
      * @return pointer to a transform component
      */
     Transform* GetTransform();
@@ -129,6 +190,8 @@ public:
     
     std::string tag = "";///the tag of this gameOjbect
     
+    bool updateInParallel = false;///whether Update of this gameObject may run on a job thread alongside other gameObjects. Only set it if its scripts touch nothing but this gameObject.
+    
     /**
      * \brief Set the physical body of the object
      *
@@ -155,9 +218,66 @@ public:
      * @param flag target sensor state
      */
     void SetSensor(bool flag);
+    
+    /**
+     * \brief Get the component store of this object
+     * @return component store, nullptr if the components are owned by the object itself
+     */
+    ComponentStore* GetComponentStore();
+    
+    /**
+     * \brief Get the entity of this object in its component store
+     * @return entity id, kInvalidEntity if the object does not live in a store
+     */
+    Entity GetEntity() const;
+    
+    /**
+     * \brief Get the handle of this object in the engine's object pool
+     * @return handle, which the engine resolves to nullptr once the object is recycled
+     */
+    GameObjectHandle GetHandle() const;
+    
+    /**
+     * \brief Set the handle of this object in the engine's object pool
+     * @param handle pool handle
+     * @param index position of this object in the engine's object list
+     */
+    void SetHandle(GameObjectHandle handle, size_t index);
+    
+    /**
+     * \brief Get the position of this object in the engine's object list
+     * @return index used to remove the object without searching the list
+     */
+    size_t GetEngineIndex() const;
+    
+    /**
+     * \brief Mark the built-in components as owned by the engine's pools
+     * Pooled components are returned to their pools by the engine instead of being deleted with the object.
+     * @param pooled whether the built-in components are pooled
+     */
+    void SetComponentsPooled(bool pooled);
 
 private:
+    /**
+     * \brief Make a component found by GetComponent under a type id
+     * @param component component of the object
+     * @param id type id to register it under, kUnknownComponentType does nothing
+     */
+    void RegisterComponent(Component* component, ComponentTypeId id)
+    {
+        if(id == kUnknownComponentType)
+        {
+            return;
+        }
+        if(id >= m_componentSlots.size())
+        {
+            m_componentSlots.resize(id + 1, nullptr);
+        }
+        m_componentSlots[id] = component;
+    }
+
     std::vector<Component*> m_components;///< All components of this game object.
+    std::vector<Component*> m_componentSlots;///< Components indexed by their ComponentTypeId, nullptr when absent.
     Transform* m_Transform;///< Transform component of this game object.
     SpriteRenderer* m_SpriteRenderer;///<Sprite renderer component of this game object.
     Animator* m_Animator;///< Animator component of this game object.
@@ -167,6 +287,18 @@ private:
 
     b2Body* m_body = nullptr;///<Physical body of this game object.
     PhysicsEngine* m_physicalEngine = nullptr;///<Current physical engine.
+
+    ComponentStore* m_store = nullptr;///<Component store of the built-in components, nullptr if not used.
+    Entity m_entity = kInvalidEntity;///<Entity of this object in the component store.
+
+    GameObjectHandle m_handle;///<Handle of this object in the engine's object pool.
+    size_t m_engineIndex = 0;///<Position of this object in the engine's object list.
+    bool m_componentsPooled = false;///<Whether the built-in components belong to the engine's pools.
+    bool m_destroyPending = false;///<Whether the object is queued for destruction at the end of the frame.
+    
+    uint32_t m_spatialId = SpatialHash<GameObject*>::kInvalidId;///<Id of this object in the engine's spatial index.
+    
+    friend class Engine;
 };
 
 #endif /* GameObject_hpp */
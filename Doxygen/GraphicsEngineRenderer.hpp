@@ -9,6 +9,11 @@
     #include <SDL.h>
 #endif
 
+#include <string>
+
+#include "RenderQueue.hpp"
+#include "SoftwareRasterizer.hpp"
+
 /**
  * @class GraphicsEngineRenderer
  * @brief This class serves as an interface to the main graphics renderer for our engine.
@@ -19,6 +24,12 @@ class GraphicsEngineRenderer{
          * Constructor
          */
         GraphicsEngineRenderer(int w, int h);
+        /**
+         * Constructor of a renderer without a window.
+         * With headless set, the frame is drawn by the SDL software
+         * renderer into a surface in memory, so no display is needed.
+         */
+        GraphicsEngineRenderer(int w, int h, bool headless);
         /**
          * Destructor
          */
@@ -33,27 +44,78 @@ class GraphicsEngineRenderer{
          */
         void RenderClear();
         /**
-         * Render whatever is in the backbuffer to
-         * the screen.
+         * Flush the render queue, then render whatever
+         * is in the backbuffer to the screen.
+         * With the software rasterizer, the queue is drawn
+         * into its framebuffer instead, which is uploaded to
+         * a streaming texture and presented with one copy,
+         * or left in memory in headless mode. The frame is
+         * also written to disk if a frame output is set.
          */
         void RenderPresent();
+        /**
+         * Draw the render queue on the CPU from now on,
+         * with the tiles spread over a job system.
+         * Only sprites submitted to the render queue are
+         * drawn: the tile map and anything drawn straight
+         * with SDL calls are not part of the frame, and
+         * every texture used must be registered with
+         * GetSoftwareRasterizer()->RegisterTexture.
+         */
+        void EnableSoftwareRasterizer(JobSystem* jobs, SampleFilter filter);
+        /**
+         * Get the software rasterizer, nullptr unless enabled
+         */
+        SoftwareRasterizer* GetSoftwareRasterizer() { return m_software; }
+        /**
+         * Write every presented frame of the software
+         * rasterizer as a BMP file in a directory, named
+         * frame_000000.bmp, frame_000001.bmp and so on.
+         * An empty directory stops writing frames.
+         */
+        void SetFrameOutput(std::string const& directory);
         /**
          * Get Pointer to Window
          */
         SDL_Window* GetWindow();
+        /**
+         * Get the surface drawn to in headless mode, nullptr otherwise
+         */
+        SDL_Surface* GetSurface() { return m_surface; }
+        /**
+         * Whether the renderer draws without a window
+         */
+        bool IsHeadless() const { return m_surface != nullptr; }
         /**
          * Get Pointer to Renderer
          */
         SDL_Renderer* GetRenderer();
+        /**
+         * Get the queue that sprites are submitted to
+         */
+        RenderQueue* GetRenderQueue();
+        /**
+         * Get the draw call and batch counters of the last presented frame
+         */
+        RenderStats const& GetRenderStats() const;
 
     private:
         // Screen dimension constants
         int m_screenHeight;///< Height of the window.
         int m_screenWidth;///<Width of the window.
         // SDL Window
-        SDL_Window* m_window;///<Pointer to the SDL window.
+        SDL_Window* m_window = nullptr;///<Pointer to the SDL window, nullptr in headless mode.
+        // Target of the software renderer
+        SDL_Surface* m_surface = nullptr;///<Surface drawn to in headless mode.
         // SDL Renderer
         SDL_Renderer* m_renderer = nullptr;///<Pointer to the SDL renderer.
+        // Sprites waiting to be batched
+        RenderQueue m_renderQueue;///<Sprites submitted during the current frame.
+        // CPU backend
+        SoftwareRasterizer* m_software = nullptr;///<Rasterizer drawing the queue, nullptr to draw with SDL.
+        SDL_Texture* m_streamingTexture = nullptr;///<Texture the software frame is uploaded to, nullptr in headless mode.
+        std::string m_frameOutput;///<Directory the software frames are written to, empty for none.
+        int m_frameIndex = 0;///<Number of the next frame written.
 };
 
 #endif
@@ -0,0 +1,529 @@
+#ifndef JobSystem_hpp
+#define JobSystem_hpp
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct JobCounter
+ * @brief Number of unfinished jobs of a group, waited on with JobSystem::Wait.
+ */
+struct JobCounter
+{
+    std::atomic<int> pending{0};///< Jobs submitted and not finished yet.
+};
+
+/**
+ * @class JobFunction
+ * @brief Move-only callable that keeps small functions inline instead of on the heap.
+ * @details Jobs are submitted every frame, mostly lambdas capturing a few pointers, so storing them without an
+ * allocation keeps a steady frame away from the global allocator. Larger functions are moved to the heap.
+ */
+class JobFunction
+{
+public:
+    static const size_t kInlineSize = 48;///< Largest function stored inline.
+
+    JobFunction() {}
+
+    template <typename Function, typename = typename std::enable_if<
+        !std::is_same<typename std::decay<Function>::type, JobFunction>::value>::type>
+    JobFunction(Function&& function)
+    {
+        typedef typename std::decay<Function>::type Stored;
+        Store<Stored>(std::forward<Function>(function),
+                      std::integral_constant<bool, sizeof(Stored) <= kInlineSize
+                                             && alignof(Stored) <= alignof(std::max_align_t)
+                                             && std::is_nothrow_move_constructible<Stored>::value>());
+    }
+
+    JobFunction(JobFunction&& other) noexcept
+    {
+        MoveFrom(other);
+    }
+
+    JobFunction& operator=(JobFunction&& other) noexcept
+    {
+        if(this != &other)
+        {
+            Destroy();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    JobFunction(JobFunction const&) = delete;
+    JobFunction& operator=(JobFunction const&) = delete;
+
+    ~JobFunction()
+    {
+        Destroy();
+    }
+
+    void operator()()
+    {
+        m_ops->invoke(m_storage);
+    }
+
+    explicit operator bool() const
+    {
+        return m_ops != nullptr;
+    }
+
+private:
+    /**
+     * @struct Ops
+     * @brief what to do with the stored function
+     */
+    struct Ops
+    {
+        void (*invoke)(void* storage);
+        void (*move)(void* to, void* from);
+        void (*destroy)(void* storage);
+    };
+
+    template <typename Stored>
+    struct Inline
+    {
+        static void Invoke(void* storage) { (*static_cast<Stored*>(storage))(); }
+        static void Move(void* to, void* from)
+        {
+            new (to) Stored(std::move(*static_cast<Stored*>(from)));
+            static_cast<Stored*>(from)->~Stored();
+        }
+        static void Destroy(void* storage) { static_cast<Stored*>(storage)->~Stored(); }
+    };
+
+    template <typename Stored>
+    struct Heap
+    {
+        static Stored*& Pointer(void* storage) { return *static_cast<Stored**>(storage); }
+        static void Invoke(void* storage) { (*Pointer(storage))(); }
+        static void Move(void* to, void* from) { Pointer(to) = Pointer(from); }
+        static void Destroy(void* storage) { delete Pointer(storage); }
+    };
+
+    template <typename Stored, typename Function>
+    void Store(Function&& function, std::true_type)
+    {
+        static const Ops ops = {&Inline<Stored>::Invoke, &Inline<Stored>::Move, &Inline<Stored>::Destroy};
+        new (m_storage) Stored(std::forward<Function>(function));
+        m_ops = &ops;
+    }
+
+    template <typename Stored, typename Function>
+    void Store(Function&& function, std::false_type)
+    {
+        static const Ops ops = {&Heap<Stored>::Invoke, &Heap<Stored>::Move, &Heap<Stored>::Destroy};
+        Heap<Stored>::Pointer(m_storage) = new Stored(std::forward<Function>(function));
+        m_ops = &ops;
+    }
+
+    void MoveFrom(JobFunction& other)
+    {
+        m_ops = other.m_ops;
+        if(m_ops)
+        {
+            m_ops->move(m_storage, other.m_storage);
+            other.m_ops = nullptr;
+        }
+    }
+
+    void Destroy()
+    {
+        if(m_ops)
+        {
+            m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char m_storage[kInlineSize];///< The function, or a pointer to it.
+    const Ops* m_ops = nullptr;///< How to use m_storage, nullptr when empty.
+};
+
+/**
+ * @class JobSystem
+ * @brief Thread pool with one job deque per worker and work stealing.
+ * @details A worker pushes and pops jobs at the back of its own deque, so nested jobs stay hot in its cache,
+ * and steals from the front of the others when it runs dry. Jobs submitted from outside the pool are spread
+ * over the deques. A thread waiting on a counter runs jobs itself instead of blocking, so jobs may wait on
+ * jobs they submitted. Deques are ring buffers that keep their capacity and small jobs are stored inline, so
+ * submitting does not allocate once the buffers have grown to the usual load.
+ */
+class JobSystem
+{
+public:
+    typedef std::function<void()> Job;
+
+    /**
+     * \brief Constructor, starts the workers
+     * @param workerCount number of worker threads, 0 for one less than the number of cores
+     */
+    explicit JobSystem(int workerCount = 0)
+    {
+        if(workerCount <= 0)
+        {
+            workerCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+        }
+        for(int i = 0; i < workerCount; ++i)
+        {
+            m_queues.emplace_back(new Queue());
+        }
+        for(int i = 0; i < workerCount; ++i)
+        {
+            m_workers.emplace_back([this, i]() { WorkerLoop(i); });
+        }
+    }
+
+    JobSystem(JobSystem const&) = delete;
+    JobSystem& operator=(JobSystem const&) = delete;
+
+    /**
+     * \brief Destructor, waits for the queued jobs to finish
+     */
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_quit = true;
+        }
+        m_sleepCondition.notify_all();
+        for(std::thread& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    /**
+     * \brief Queue a job
+     * @param job work to run, any callable without arguments
+     * @param counter incremented now and decremented when the job finishes, may be nullptr
+     */
+    template <typename Function>
+    void Submit(Function&& job, JobCounter* counter = nullptr)
+    {
+        if(counter)
+        {
+            counter->pending.fetch_add(1);
+        }
+        int index = CurrentWorker();
+        if(index < 0)
+        {
+            index = static_cast<int>(m_nextQueue.fetch_add(1) % m_queues.size());
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+            m_queues[index]->PushBack(Task{JobFunction(std::forward<Function>(job)), counter});
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            ++m_queued;
+        }
+        m_sleepCondition.notify_one();
+    }
+
+    /**
+     * \brief Run jobs on the calling thread until every job of a counter finished
+     * @param counter counter to wait for
+     */
+    void Wait(JobCounter& counter)
+    {
+        while(counter.pending.load() > 0)
+        {
+            if(!RunOne(CurrentWorker()))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     * \brief Call a function over [0, count) in parallel, in ranges of at most grain items
+     * Returns when every range is done. The calling thread works on ranges too.
+     * @param count number of items
+     * @param grain items per job, larger for cheaper items
+     * @param function called as function(begin, end) for each range
+     */
+    template <typename Function>
+    void ParallelFor(size_t count, size_t grain, Function function)
+    {
+        if(count == 0)
+        {
+            return;
+        }
+        grain = std::max<size_t>(1, grain);
+        if(count <= grain)
+        {
+            function(size_t(0), count);
+            return;
+        }
+        JobCounter counter;
+        for(size_t begin = grain; begin < count; begin += grain)
+        {
+            size_t end = std::min(count, begin + grain);
+            Submit([&function, begin, end]() { function(begin, end); }, &counter);
+        }
+        function(size_t(0), grain);
+        Wait(counter);
+    }
+
+    /**
+     * \brief Number of worker threads
+     */
+    int GetWorkerCount() const
+    {
+        return static_cast<int>(m_workers.size());
+    }
+
+private:
+    /**
+     * @struct Task
+     * @brief a queued job with its counter
+     */
+    struct Task
+    {
+        JobFunction job;
+        JobCounter* counter = nullptr;
+    };
+
+    /**
+     * @struct Queue
+     * @brief job deque of one worker, a ring buffer that doubles when full
+     */
+    struct Queue
+    {
+        std::mutex mutex;
+        std::vector<Task> ring = std::vector<Task>(64);
+        size_t head = 0;///< Index of the front job.
+        size_t count = 0;///< Number of queued jobs.
+
+        void PushBack(Task task)
+        {
+            if(count == ring.size())
+            {
+                std::vector<Task> larger(ring.size() * 2);
+                for(size_t i = 0; i < count; ++i)
+                {
+                    larger[i] = std::move(ring[(head + i) % ring.size()]);
+                }
+                ring.swap(larger);
+                head = 0;
+            }
+            ring[(head + count) % ring.size()] = std::move(task);
+            ++count;
+        }
+
+        Task PopBack()
+        {
+            --count;
+            return std::move(ring[(head + count) % ring.size()]);
+        }
+
+        Task PopFront()
+        {
+            Task task = std::move(ring[head]);
+            head = (head + 1) % ring.size();
+            --count;
+            return task;
+        }
+    };
+
+    /**
+     * \brief Index of the worker running on this thread, -1 outside the pool
+     */
+    int CurrentWorker() const
+    {
+        return ThreadPool() == this ? ThreadWorker() : -1;
+    }
+
+    /**
+     * \brief Pool the current thread works for
+     */
+    static JobSystem*& ThreadPool()
+    {
+        static thread_local JobSystem* pool = nullptr;
+        return pool;
+    }
+
+    /**
+     * \brief Index of the current thread in its pool
+     */
+    static int& ThreadWorker()
+    {
+        static thread_local int worker = -1;
+        return worker;
+    }
+
+    /**
+     * \brief Take a job from the own deque, else steal one, and run it
+     * @param self index of the calling worker, -1 outside the pool
+     * @return false if no job was found
+     */
+    bool RunOne(int self)
+    {
+        Task task;
+        bool found = false;
+        if(self >= 0)
+        {
+            std::lock_guard<std::mutex> lock(m_queues[self]->mutex);
+            if(m_queues[self]->count > 0)
+            {
+                task = m_queues[self]->PopBack();
+                found = true;
+            }
+        }
+        size_t count = m_queues.size();
+        size_t start = self >= 0 ? static_cast<size_t>(self) + 1 : 0;
+        for(size_t i = 0; !found && i < count; ++i)
+        {
+            Queue& victim = *m_queues[(start + i) % count];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(victim.count > 0)
+            {
+                task = victim.PopFront();
+                found = true;
+            }
+        }
+        if(!found)
+        {
+            return false;
+        }
+        m_queued.fetch_sub(1);
+        task.job();
+        if(task.counter)
+        {
+            task.counter->pending.fetch_sub(1);
+        }
+        return true;
+    }
+
+    void WorkerLoop(int index)
+    {
+        ThreadPool() = this;
+        ThreadWorker() = index;
+        while(true)
+        {
+            if(RunOne(index))
+            {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_sleepCondition.wait(lock, [this]() { return m_quit || m_queued.load() > 0; });
+            if(m_quit && m_queued.load() == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> m_queues;///< One deque per worker.
+    std::vector<std::thread> m_workers;///< Worker threads.
+    std::atomic<size_t> m_nextQueue{0};///< Round robin for jobs from outside the pool.
+    std::atomic<int> m_queued{0};///< Jobs in all deques.
+    std::mutex m_sleepMutex;///< Guards sleeping and m_quit.
+    std::condition_variable m_sleepCondition;///< Wakes idle workers.
+    bool m_quit = false;///< Set by the destructor.
+};
+
+/**
+ * @class JobGraph
+ * @brief Set of jobs with explicit ordering between them.
+ * @details A node starts once every node it depends on finished. Nodes without dependencies start at once, so
+ * independent work runs in parallel. The graph can be run again every frame.
+ */
+class JobGraph
+{
+public:
+    /**
+     * \brief Add a node
+     * @param work job of the node, may itself use ParallelFor
+     * @return id of the node
+     */
+    int Add(JobSystem::Job work)
+    {
+        m_nodes.push_back(Node());
+        m_nodes.back().work = std::move(work);
+        return static_cast<int>(m_nodes.size() - 1);
+    }
+
+    /**
+     * \brief Make a node wait for another
+     * @param before node that must finish first
+     * @param after node that starts after it
+     */
+    void Precede(int before, int after)
+    {
+        m_nodes[before].next.push_back(after);
+        ++m_nodes[after].dependencies;
+    }
+
+    /**
+     * \brief Run every node in dependency order and wait until all finished
+     * @param jobs job system running the nodes
+     */
+    void Run(JobSystem& jobs)
+    {
+        if(m_remainingSize != m_nodes.size())
+        {
+            m_remaining.reset(new std::atomic<int>[m_nodes.size()]);
+            m_remainingSize = m_nodes.size();
+        }
+        for(size_t i = 0; i < m_nodes.size(); ++i)
+        {
+            m_remaining[i].store(m_nodes[i].dependencies);
+        }
+        JobCounter counter;
+        for(size_t i = 0; i < m_nodes.size(); ++i)
+        {
+            if(m_nodes[i].dependencies == 0)
+            {
+                Start(jobs, static_cast<int>(i), counter);
+            }
+        }
+        jobs.Wait(counter);
+    }
+
+private:
+    /**
+     * @struct Node
+     * @brief a job and the nodes waiting for it
+     */
+    struct Node
+    {
+        JobSystem::Job work;
+        std::vector<int> next;
+        int dependencies = 0;
+    };
+
+    void Start(JobSystem& jobs, int index, JobCounter& counter)
+    {
+        jobs.Submit([this, &jobs, index, &counter]()
+                    {
+                        m_nodes[index].work();
+                        for(int next : m_nodes[index].next)
+                        {
+                            if(m_remaining[next].fetch_sub(1) == 1)
+                            {
+                                Start(jobs, next, counter);
+                            }
+                        }
+                    }, &counter);
+    }
+
+    std::vector<Node> m_nodes;///< All nodes.
+    std::unique_ptr<std::atomic<int>[]> m_remaining;///< Unfinished dependencies of each node during Run.
+    size_t m_remainingSize = 0;///< Length of m_remaining, kept between runs.
+};
+
+#endif /* JobSystem_hpp */
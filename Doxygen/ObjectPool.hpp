@@ -0,0 +1,185 @@
+#ifndef ObjectPool_hpp
+#define ObjectPool_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct PoolHandle
+ * @brief Generation-checked reference to an object in an ObjectPool.
+ * @details A handle stays safe to keep after its object is destroyed: once the slot is reused the
+ * generation no longer matches and the pool returns nullptr for it.
+ */
+struct PoolHandle
+{
+    uint32_t index = 0xFFFFFFFFu;///< Slot index in the pool.
+    uint32_t generation = 0;///< Generation of the slot when the handle was made.
+
+    /**
+     * \brief Whether the handle was ever assigned. It may still be stale.
+     */
+    bool IsValid() const
+    {
+        return index != 0xFFFFFFFFu;
+    }
+
+    bool operator==(PoolHandle const& rhs) const
+    {
+        return index == rhs.index && generation == rhs.generation;
+    }
+
+    bool operator!=(PoolHandle const& rhs) const
+    {
+        return !(*this == rhs);
+    }
+};
+
+/**
+ * @class ObjectPool
+ * @brief Fixed-address pool allocator with slot recycling.
+ * @details Objects live in chunks of ChunkSize slots that are never moved or freed until the pool dies,
+ * so pointers stay valid while the object is alive. Destroyed slots go to a free list and are reused
+ * by the next Create(), which bumps the slot generation to invalidate old handles.
+ */
+template <typename T, size_t ChunkSize = 256>
+class ObjectPool
+{
+public:
+    ObjectPool() = default;
+    ObjectPool(ObjectPool const&) = delete;
+    ObjectPool& operator=(ObjectPool const&) = delete;
+
+    /**
+     * \brief Destroy every object that is still alive
+     */
+    ~ObjectPool()
+    {
+        for(uint32_t i = 0; i < m_slotCount; ++i)
+        {
+            Slot& slot = SlotAt(i);
+            if(slot.alive)
+            {
+                slot.Object()->~T();
+            }
+        }
+    }
+
+    /**
+     * \brief Construct an object in a free slot
+     * @param args constructor arguments of T
+     * @return handle of the new object
+     */
+    template <typename... Args>
+    PoolHandle Create(Args&&... args)
+    {
+        uint32_t index;
+        if(m_freeHead != kNoSlot)
+        {
+            index = m_freeHead;
+            m_freeHead = SlotAt(index).nextFree;
+        }
+        else
+        {
+            if(m_slotCount == m_chunks.size() * ChunkSize)
+            {
+                m_chunks.emplace_back(new Slot[ChunkSize]);
+            }
+            index = m_slotCount++;
+        }
+        Slot& slot = SlotAt(index);
+        new (slot.storage) T(std::forward<Args>(args)...);
+        slot.alive = true;
+        ++m_aliveCount;
+
+        PoolHandle handle;
+        handle.index = index;
+        handle.generation = slot.generation;
+        return handle;
+    }
+
+    /**
+     * \brief Destroy an object and put its slot on the free list. Stale handles are ignored.
+     * @param handle handle of the object
+     */
+    void Destroy(PoolHandle handle)
+    {
+        if(!Get(handle))
+        {
+            return;
+        }
+        Slot& slot = SlotAt(handle.index);
+        slot.Object()->~T();
+        slot.alive = false;
+        ++slot.generation;
+        slot.nextFree = m_freeHead;
+        m_freeHead = handle.index;
+        --m_aliveCount;
+    }
+
+    /**
+     * \brief Get the object of a handle
+     * @param handle handle of the object
+     * @return pointer to the object, nullptr if the handle is stale or was never assigned
+     */
+    T* Get(PoolHandle handle)
+    {
+        if(handle.index >= m_slotCount)
+        {
+            return nullptr;
+        }
+        Slot& slot = SlotAt(handle.index);
+        return slot.alive && slot.generation == handle.generation ? slot.Object() : nullptr;
+    }
+
+    /**
+     * \brief Number of objects alive in the pool
+     */
+    size_t Size() const
+    {
+        return m_aliveCount;
+    }
+
+    /**
+     * \brief Number of slots allocated so far, alive or free
+     */
+    size_t Capacity() const
+    {
+        return m_chunks.size() * ChunkSize;
+    }
+
+private:
+    static const uint32_t kNoSlot = 0xFFFFFFFFu;///< End of the free list.
+
+    /**
+     * @struct Slot
+     * @brief Storage of one object plus its bookkeeping
+     */
+    struct Slot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];///< Raw storage of the object.
+        uint32_t generation = 0;///< Bumped every time the object is destroyed.
+        uint32_t nextFree = kNoSlot;///< Next slot in the free list.
+        bool alive = false;///< Whether storage holds a constructed object.
+
+        T* Object()
+        {
+            return reinterpret_cast<T*>(storage);
+        }
+    };
+
+    Slot& SlotAt(uint32_t index)
+    {
+        return m_chunks[index / ChunkSize][index % ChunkSize];
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> m_chunks;///< Slot chunks, never reallocated.
+    uint32_t m_slotCount = 0;///< Slots handed out at least once.
+    uint32_t m_freeHead = kNoSlot;///< First slot of the free list.
+    size_t m_aliveCount = 0;///< Objects currently alive.
+};
+
+#endif /* ObjectPool_hpp */
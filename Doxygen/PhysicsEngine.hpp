@@ -5,10 +5,17 @@
 #include <box2d/b2_body.h>
 #include "Vector2.hpp"
 #include "GameObject.hpp"
+#include "TileCollision.hpp"
+#include "ContactCache.hpp"
+#include "TransformSync.hpp"
+#include "PhysicsRegion.hpp"
+
+class TileMap;
 
 /**
  * \class PhysicsEngine
  * \brief This class is a wrapper class of box2d library, which provides a simulation of a physical world.
+ * The world can be split into regions that never interact, each a box2d world of its own, see PhysicsPartition.
  */
 class PhysicsEngine {
 public:
@@ -35,15 +42,32 @@ public:
     void SetScaleFactor(float scale);
     /**
      * /brief Set a static body as the tile
+     * \warning creates one body per tile, prefer AddTileMap for whole maps
      *
      * @param gameObject
      */
     void AddTile(GameObject* gameObject);
+    /**
+     * \brief Add the collision of a whole tile map as a single static body
+     *
+     * Adjacent solid tiles are merged into rectangles with MergeSolidTiles and every rectangle becomes one box
+     * fixture, which keeps the broadphase small on large maps. Calling it again replaces the previous map.
+     * Every region gets a static body of its own: the default region has the whole map, a bounded region only the
+     * rectangles cut by ClipTileRects to the tiles within its bounds grown by the migration margin plus one tile,
+     * see TilesInBounds. AddRegion calls it again, so regions added after the map get their part too.
+     *
+     * @param tileMap
+     * @param emptyTile tile type that does not collide
+     * @return the static body of the map in the default region
+     */
+    b2Body* AddTileMap(TileMap* tileMap, int emptyTile = -1);
     /**
     * \brief Adds a game object into the engine
     *
     * Adding a game object into the engine allows the engine to simulate physical effects
     * on the sprite. The simulation may modify the state of the sprite.
+    * The body is created in the world of the region containing the object, and unless it is static, its transform
+    * is added to the transform sync of that region.
     * \param[in] sprite The sprite to be added.
     */
     void AddGameObject(GameObject* gameObject);
@@ -51,19 +75,30 @@ public:
      * \brief Removes a game object from the engine
      *
      * Removing a game object from the engine stops the engine performing physical computation
-     * on it.
+     * on it. Its transform leaves the transform sync before the body is destroyed. After the body is destroyed,
+     * ContactCache::PurgeEvents runs on the contact cache of every region, so no callback runs on a released object;
+     * the objects it touched still get their exit callback, with a null other.
      * \param[in] sprite The sprite to be removed.
      */
     void RemoveGameObject(GameObject* gameObject);
     /**
      * \brief Updates the state of everything in the engine into the next frame.
      * \warning the elapsed time has to be second unit (s)
+     * The engine calls it with a fixed step, so the simulation does not depend on the frame rate.
+     * Objects that left their region move to the world of their new region first, then every region is stepped,
+     * in parallel on the job system set with SetJobSystem; see PhysicsPartition::Step. In each region, positions set on
+     * transforms are written to their bodies and moving transforms save their previous position before the step;
+     * after it, the awake bodies are copied to their transforms and the contact cache of the region is rebuilt.
+     * The collision callbacks of colliders are called last, on the calling thread, region by region.
+     * The step and the callbacks are timed in the profiler as "PhysicsEngine::Step" and "PhysicsEngine::Contacts".
      *
      * \param[in] duration The duration since the last frame.
      */
     void Update(float duration);
     /**
      * \brief Set the position of the body of the game object in the physical world
+     * Moves the body right away; Transform::SetPosition batches the move before the next step instead.
+     * Wakes the body, see TransformSync::Wake.
      *
      * @param gameObject
      * @param center
@@ -106,6 +141,7 @@ public:
     static void SetFriction(GameObject* gameObject, float friction);
     /**
      * \brief Apply force to the object
+     * Wakes the body, see TransformSync::Wake.
      *
      * @param gameObject
      * @param force
@@ -113,6 +149,7 @@ public:
     static void ApplyForce(GameObject* gameObject, Vector2 const& force);
     /**
      * \brief Apply impulse to the object
+     * Wakes the body, see TransformSync::Wake.
      *
      * @param gameObject
      * @param impulse
@@ -127,6 +164,7 @@ public:
     static void SetObjectGravityScale(GameObject* gameObject, float scale);
     /**
      * \brief Set the linear velocity of the object
+     * Wakes the body, see TransformSync::Wake.
      *
      * @param gameObject
      * @param v
@@ -141,6 +179,7 @@ public:
     static Vector2 GetObjectLinearVelocity(GameObject* gameObject);
     /**
      * \brief Get the contact list of a game object
+     * \warning copies the cached contacts, prefer GetContacts
      *
      * @param gameObject
      */
@@ -152,10 +191,93 @@ public:
      * @return contact list
      */
     std::vector<Contact> GetSensorContactList(GameObject* gameObject) const;
+    /**
+     * \brief Get the contacts of a game object recorded in the last step, without copying
+     *
+     * @param gameObject
+     * @return view of the contacts, valid until the next step
+     */
+    ContactSpan GetContacts(GameObject* gameObject) const
+    {
+        return GetContactCache(gameObject).Find(gameObject, false);
+    }
+    /**
+     * \brief Get the contacts of a game object with sensors recorded in the last step, without copying
+     *
+     * @param gameObject
+     * @return view of the contacts, valid until the next step
+     */
+    ContactSpan GetSensorContacts(GameObject* gameObject) const
+    {
+        return GetContactCache(gameObject).Find(gameObject, true);
+    }
+    /**
+     * \brief Get the contacts of the region the body of a game object is in
+     *
+     * @param gameObject
+     * @return contact cache of the region, the default region's one if the object has no body
+     */
+    ContactCache const& GetContactCache(GameObject* gameObject) const;
+    /**
+     * \brief Get the sync between the transforms and the bodies of the region the body of a game object is in
+     *
+     * @param gameObject
+     * @return the transform sync
+     */
+    TransformSync& GetTransformSync(GameObject* gameObject);
+    /**
+     * \brief Add a region of the level simulated in its own world, before objects are added inside it
+     * Objects in different regions never collide, so regions should be separated by walls. The collision of the
+     * tile map, if any, is rebuilt so the new region gets its part of it.
+     *
+     * @param min top left corner in pixels
+     * @param max bottom right corner in pixels
+     * @return index of the region
+     */
+    int AddRegion(Vector2 const& min, Vector2 const& max)
+    {
+        int index = m_partition->AddRegion(min, max);
+        if(m_tileMap)
+        {
+            AddTileMap(m_tileMap, m_emptyTile);
+        }
+        return index;
+    }
+    /**
+     * \brief Get the regions of the world
+     *
+     * @return the partition, whose region 0 holds the world outside every added region
+     */
+    PhysicsPartition& GetPartition()
+    {
+        return *m_partition;
+    }
+    /**
+     * \brief Set the job system the regions are stepped on
+     * Used once the level has several regions, see PhysicsPartition::Step.
+     *
+     * @param jobs job system, nullptr to step the regions on the calling thread
+     */
+    void SetJobSystem(JobSystem* jobs)
+    {
+        m_jobs = jobs;
+    }
     
 private:
+    /**
+     * \brief Call the collision callbacks of the colliders for the events of the last step
+     * The null side of an end event left by ContactCache::PurgeEvents gets no callback.
+     */
+    void DispatchContactEvents();
+    
     float m_scale = 64.0f;///< Default scale of physics engine objects.
-    b2World* m_world = nullptr;///< Pointer to physics world.
+    PhysicsPartition* m_partition = nullptr;///< Regions of the world, each with its world, contacts and transform sync.
+    b2World* m_world = nullptr;///< Pointer to the world of the default region.
+    std::vector<b2Body*> m_tileMapBodies;///< Static body of the tile map collision in each region, by region index.
+    TileMap* m_tileMap = nullptr;///< Tile map given to AddTileMap, rebuilt by AddRegion.
+    int m_emptyTile = -1;///< Tile type of m_tileMap that does not collide.
+    std::vector<ContactEvent> m_contactEvents;///< Events being dispatched, reused between steps.
+    JobSystem* m_jobs = nullptr;///< Job system the regions are stepped on, if any.
 };
 
 
@@ -0,0 +1,472 @@
+#ifndef PhysicsRegion_hpp
+#define PhysicsRegion_hpp
+
+#include <box2d/box2d.h>
+#include <box2d/b2_body.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "Vector2.hpp"
+#include "ContactCache.hpp"
+#include "TransformSync.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+
+/**
+ * \brief Move a body into another world, keeping its state and fixtures
+ * The old body is destroyed, which ends its contacts in the old world and fires EndContact for them. Bodies with
+ * joints cannot move, since a joint cannot link two worlds.
+ * @param body body to move, invalid afterwards if the move succeeded
+ * @param target world to move it to
+ * @return the new body, nullptr if the body has joints and was left where it is
+ */
+inline b2Body* MigrateBody(b2Body* body, b2World* target)
+{
+    if(body->GetJointList())
+    {
+        return nullptr;
+    }
+    b2BodyDef def;
+    def.type = body->GetType();
+    def.position = body->GetPosition();
+    def.angle = body->GetAngle();
+    def.linearVelocity = body->GetLinearVelocity();
+    def.angularVelocity = body->GetAngularVelocity();
+    def.linearDamping = body->GetLinearDamping();
+    def.angularDamping = body->GetAngularDamping();
+    def.allowSleep = body->IsSleepingAllowed();
+    def.awake = body->IsAwake();
+    def.fixedRotation = body->IsFixedRotation();
+    def.bullet = body->IsBullet();
+    def.enabled = body->IsEnabled();
+    def.userData = body->GetUserData();
+    def.gravityScale = body->GetGravityScale();
+    b2Body* moved = target->CreateBody(&def);
+    for(b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+    {
+        b2FixtureDef fixtureDef;
+        fixtureDef.shape = fixture->GetShape();
+        fixtureDef.userData = fixture->GetUserData();
+        fixtureDef.friction = fixture->GetFriction();
+        fixtureDef.restitution = fixture->GetRestitution();
+        fixtureDef.density = fixture->GetDensity();
+        fixtureDef.isSensor = fixture->IsSensor();
+        fixtureDef.filter = fixture->GetFilterData();
+        moved->CreateFixture(&fixtureDef);
+    }
+    body->GetWorld()->DestroyBody(body);
+    return moved;
+}
+
+/**
+ * @class PhysicsRegion
+ * @brief One box2d world simulating a part of the level, with its own contacts and transform sync.
+ * @details Everything a step touches belongs to the region, so regions can be stepped at once, see
+ * PhysicsPartition::Step. Bounds are in pixels; the default region has none and holds whatever is outside every
+ * other region.
+ */
+class PhysicsRegion
+{
+public:
+    /**
+     * \brief Constructor of the default region, without bounds
+     * @param gravity gravity of the world
+     */
+    explicit PhysicsRegion(b2Vec2 const& gravity)
+    : m_world(new b2World(gravity))
+    {
+        m_world->SetContactListener(&m_contacts);
+    }
+
+    /**
+     * \brief Constructor of a bounded region
+     * @param gravity gravity of the world
+     * @param min top left corner of the region in pixels
+     * @param max bottom right corner of the region in pixels
+     */
+    PhysicsRegion(b2Vec2 const& gravity, Vector2 const& min, Vector2 const& max)
+    : m_world(new b2World(gravity)), m_min(min), m_max(max), m_bounded(true)
+    {
+        m_world->SetContactListener(&m_contacts);
+    }
+
+    PhysicsRegion(PhysicsRegion const&) = delete;
+    PhysicsRegion& operator=(PhysicsRegion const&) = delete;
+
+    ~PhysicsRegion()
+    {
+        delete m_world;
+    }
+
+    /**
+     * \brief Whether a position is inside the region, the default region contains everything
+     * @param position position in pixels
+     * @param margin distance the bounds are grown by, negative to shrink them
+     */
+    bool Contains(Vector2 const& position, float margin = 0.0f) const
+    {
+        return !m_bounded
+            || (position.x >= m_min.x - margin && position.x < m_max.x + margin
+                && position.y >= m_min.y - margin && position.y < m_max.y + margin);
+    }
+
+    /**
+     * \brief Step the world and rebuild its contacts
+     * Dirty transforms are written to their bodies first and awake bodies are copied back after, see TransformSync.
+     * @param duration length of the step in seconds
+     * @param scale pixels per meter
+     * @param velocityIterations velocity iterations of the solver
+     * @param positionIterations position iterations of the solver
+     */
+    void Step(float duration, float scale, int velocityIterations, int positionIterations)
+    {
+        PROFILE_SCOPE("PhysicsRegion::Step");
+        m_sync.FlushDirty(scale);
+        m_sync.SavePreviousPositions();
+        m_world->Step(duration, velocityIterations, positionIterations);
+        m_sync.CollectAwake(scale);
+        m_contacts.Rebuild(m_world);
+    }
+
+    /**
+     * \brief Get the box2d world
+     */
+    b2World* GetWorld()
+    {
+        return m_world;
+    }
+
+    /**
+     * \brief Get the contacts of the last step
+     */
+    ContactCache& GetContacts()
+    {
+        return m_contacts;
+    }
+
+    /**
+     * \brief Get the sync of the transforms of the bodies of the region
+     */
+    TransformSync& GetTransformSync()
+    {
+        return m_sync;
+    }
+
+    /**
+     * \brief Top left corner in pixels, unused by the default region
+     */
+    Vector2 const& GetMin() const
+    {
+        return m_min;
+    }
+
+    /**
+     * \brief Bottom right corner in pixels, unused by the default region
+     */
+    Vector2 const& GetMax() const
+    {
+        return m_max;
+    }
+
+    /**
+     * \brief Whether the region has bounds, false for the default region
+     */
+    bool IsBounded() const
+    {
+        return m_bounded;
+    }
+
+private:
+    b2World* m_world;///< World of the region.
+    ContactCache m_contacts;///< Contacts and events of the last step, listener of the world.
+    TransformSync m_sync;///< Transforms of the non static bodies of the world.
+    Vector2 m_min{0, 0};///< Top left corner in pixels.
+    Vector2 m_max{0, 0};///< Bottom right corner in pixels.
+    bool m_bounded = false;///< Whether the bounds are used.
+};
+
+/**
+ * @class PhysicsPartition
+ * @brief Splits the level into regions that never interact, each with its own world.
+ * @details Region 0 is the default region, the only one until AddRegion is called. Bodies are created in the
+ * region containing them and move to another one when they cross its bounds by more than the migration margin,
+ * so an object on a border does not go back and forth. Objects in different regions never collide: regions are
+ * meant for rooms and arenas separated by walls, not for cutting a connected scene.
+ */
+class PhysicsPartition
+{
+public:
+    /**
+     * \brief Constructor
+     * @param gravity gravity of every world
+     */
+    explicit PhysicsPartition(b2Vec2 const& gravity)
+    : m_gravity(gravity)
+    {
+        InitializeContactRegisters();
+        m_regions.push_back(new PhysicsRegion(gravity));
+    }
+
+    PhysicsPartition(PhysicsPartition const&) = delete;
+    PhysicsPartition& operator=(PhysicsPartition const&) = delete;
+
+    ~PhysicsPartition()
+    {
+        for(PhysicsRegion* region : m_regions)
+        {
+            delete region;
+        }
+    }
+
+    /**
+     * \brief Add a region with its own world, before bodies are created inside it
+     * Regions must not overlap; a position inside several of them belongs to the first one added.
+     * @param min top left corner in pixels
+     * @param max bottom right corner in pixels
+     * @return index of the region
+     */
+    int AddRegion(Vector2 const& min, Vector2 const& max)
+    {
+        m_regions.push_back(new PhysicsRegion(m_gravity, min, max));
+        return static_cast<int>(m_regions.size() - 1);
+    }
+
+    /**
+     * \brief Number of regions, the default one included
+     */
+    int GetRegionCount() const
+    {
+        return static_cast<int>(m_regions.size());
+    }
+
+    /**
+     * \brief Get a region
+     * @param index index of the region, 0 for the default one
+     */
+    PhysicsRegion& GetRegion(int index)
+    {
+        return *m_regions[index];
+    }
+
+    /**
+     * \brief Find the region a position belongs to
+     * @param position position in pixels
+     * @return index of the first bounded region containing it, 0 if none does
+     */
+    int FindRegion(Vector2 const& position) const
+    {
+        for(size_t i = 1; i < m_regions.size(); ++i)
+        {
+            if(m_regions[i]->Contains(position))
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * \brief Find the region of a body, to route contact queries to the right cache
+     * @param body body of any region
+     * @return index of the region owning its world, 0 if none does
+     */
+    int FindRegion(b2Body* body) const
+    {
+        b2World* world = body->GetWorld();
+        for(size_t i = 1; i < m_regions.size(); ++i)
+        {
+            if(m_regions[i]->GetWorld() == world)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * \brief Set the gravity of every world
+     * @param gravity gravity in meters per second squared
+     */
+    void SetGravity(b2Vec2 const& gravity)
+    {
+        m_gravity = gravity;
+        for(PhysicsRegion* region : m_regions)
+        {
+            region->GetWorld()->SetGravity(gravity);
+        }
+    }
+
+    /**
+     * \brief Set how far past the bounds of its region an object goes before it migrates
+     * @param margin distance in pixels
+     */
+    void SetMigrationMargin(float margin)
+    {
+        m_margin = margin;
+    }
+
+    /**
+     * \brief Get how far past the bounds of its region an object goes before it migrates
+     */
+    float GetMigrationMargin() const
+    {
+        return m_margin;
+    }
+
+    /**
+     * \brief Move the awake objects that left their region, then step every region
+     * Migration runs first, on the calling thread, so contacts of the step are always in the cache of the region
+     * the body is in. The regions are then stepped in parallel on the job system: each has its own world, block
+     * allocators, contact cache and transform sync. The one table box2d fills lazily, its contact registers, is
+     * filled by the constructor. The call counters box2d keeps in globals, such as b2_gjkCalls, are statistics
+     * nothing reads; they lose counts when worlds are stepped at once.
+     * @param duration length of the step in seconds
+     * @param scale pixels per meter
+     * @param jobs job system to step the regions on, nullptr to step them one after the other
+     * @param onMigrate called as onMigrate(transform, body) for each object moved to another world
+     */
+    template <typename Function>
+    void Step(float duration, float scale, JobSystem* jobs, Function onMigrate)
+    {
+        Migrate(scale, onMigrate);
+        PROFILE_SCOPE("PhysicsPartition::Step");
+        if(jobs && m_regions.size() > 1)
+        {
+            jobs->ParallelFor(m_regions.size(), 1, [this, duration, scale](size_t begin, size_t end)
+                              {
+                                  for(size_t i = begin; i < end; ++i)
+                                  {
+                                      m_regions[i]->Step(duration, scale, kVelocityIterations, kPositionIterations);
+                                  }
+                              });
+            return;
+        }
+        for(PhysicsRegion* region : m_regions)
+        {
+            region->Step(duration, scale, kVelocityIterations, kPositionIterations);
+        }
+    }
+
+    /**
+     * \brief Number of objects moved to another world by the last step
+     */
+    int GetMigrationCount() const
+    {
+        return m_migrationCount;
+    }
+
+    static const int kVelocityIterations = 8;///< Velocity iterations of every world.
+    static const int kPositionIterations = 3;///< Position iterations of every world.
+
+private:
+    /**
+     * \brief Fill the contact registers of box2d on the calling thread
+     * box2d fills them on the first contact created by any world, which would race when regions are stepped at once.
+     */
+    static void InitializeContactRegisters()
+    {
+        b2World world(b2Vec2(0.0f, 0.0f));
+        b2CircleShape circle;
+        circle.m_radius = 1.0f;
+        b2FixtureDef fixtureDef;
+        fixtureDef.shape = &circle;
+        b2BodyDef def;
+        def.type = b2_dynamicBody;
+        world.CreateBody(&def)->CreateFixture(&fixtureDef);
+        world.CreateBody(&def)->CreateFixture(&fixtureDef);
+        world.Step(0.0f, 1, 1);
+    }
+
+    /**
+     * @struct Migration
+     * @brief an object that left its region
+     */
+    struct Migration
+    {
+        Transform* transform;
+        b2Body* body;
+        int from;
+        int to;
+    };
+
+    /**
+     * \brief Move the bodies awake after the last step whose position is now in another region
+     * Only awake bodies are checked, since a sleeping body cannot have moved. Dirty transforms are flushed first,
+     * so a body is moved with the position its user gave it; one set into another region migrates after the step
+     * that woke it. Destroying the old body fires the end events of its contacts in the old region, so the object
+     * and the objects it touched there get their exit callbacks; the new world fires the begin events of what it
+     * touches there during the step.
+     */
+    template <typename Function>
+    void Migrate(float scale, Function& onMigrate)
+    {
+        m_migrationCount = 0;
+        if(m_regions.size() < 2)
+        {
+            return;
+        }
+        PROFILE_SCOPE("PhysicsPartition::Migrate");
+        m_migrations.clear();
+        for(size_t from = 0; from < m_regions.size(); ++from)
+        {
+            PhysicsRegion& region = *m_regions[from];
+            TransformSync& sync = region.GetTransformSync();
+            sync.FlushDirty(scale);
+            for(size_t i = 0; i < sync.GetAwakeCount(); ++i)
+            {
+                Transform* transform = sync.GetAwakeTransform(i);
+                if(!transform)
+                {
+                    continue;
+                }
+                Vector2 position = transform->position;
+                if(region.Contains(position, m_margin) && (region.IsBounded() || FindRegion(position, -m_margin) == 0))
+                {
+                    continue;
+                }
+                int to = FindRegion(position);
+                if(to != static_cast<int>(from))
+                {
+                    m_migrations.push_back(Migration{transform, sync.GetAwakeBody(i), static_cast<int>(from), to});
+                }
+            }
+        }
+        for(Migration const& migration : m_migrations)
+        {
+            b2Body* body = MigrateBody(migration.body, m_regions[migration.to]->GetWorld());
+            if(!body)
+            {
+                continue;
+            }
+            m_regions[migration.from]->GetTransformSync().Remove(migration.transform);
+            m_regions[migration.to]->GetTransformSync().Add(migration.transform, body);
+            onMigrate(migration.transform, body);
+            ++m_migrationCount;
+        }
+    }
+
+    /**
+     * \brief Find the bounded region containing a position with its bounds grown by a margin
+     * @return index of the region, 0 if none
+     */
+    int FindRegion(Vector2 const& position, float margin) const
+    {
+        for(size_t i = 1; i < m_regions.size(); ++i)
+        {
+            if(m_regions[i]->Contains(position, margin))
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return 0;
+    }
+
+    std::vector<PhysicsRegion*> m_regions;///< All regions, the default one first.
+    std::vector<Migration> m_migrations;///< Objects leaving their region, reused between steps.
+    b2Vec2 m_gravity;///< Gravity of every world.
+    float m_margin = 32.0f;///< Distance past the bounds before an object migrates, in pixels.
+    int m_migrationCount = 0;///< Objects moved by the last step.
+};
+
+#endif /* PhysicsRegion_hpp */
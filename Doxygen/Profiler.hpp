@@ -0,0 +1,451 @@
+#ifndef Profiler_hpp
+#define Profiler_hpp
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FrameArena.hpp"
+
+/**
+ * @struct ProfileEvent
+ * @brief One timed scope, times in nanoseconds since the profiler started.
+ */
+struct ProfileEvent
+{
+    const char* name = nullptr;///< Name of the scope, must outlive the profiler (a string literal).
+    uint64_t start = 0;///< Time the scope was entered.
+    uint64_t end = 0;///< Time the scope was left.
+    uint32_t depth = 0;///< Number of scopes open around it on the same thread.
+};
+
+/**
+ * @struct ProfileStats
+ * @brief Time spent in a scope per frame, over the recent frames the scope ran in.
+ */
+struct ProfileStats
+{
+    float minMs = 0.0f;///< Shortest frame.
+    float avgMs = 0.0f;///< Mean over the frames.
+    float p99Ms = 0.0f;///< 99th percentile.
+    float maxMs = 0.0f;///< Longest frame.
+    int frames = 0;///< Number of frames the figures are taken from.
+};
+
+/**
+ * @class Profiler
+ * @brief Collects timed scopes from every thread, keeps per frame statistics and writes Chrome traces.
+ * @details Each thread records into its own ring buffer, so recording never contends with other threads.
+ * When a buffer is full the oldest events are overwritten. EndFrame, called once per frame by the main loop,
+ * sums the time of each scope name over the frame and keeps the sums of the last kHistoryFrames frames.
+ * The trace written by ExportChromeTrace holds the events still in the ring buffers and opens in
+ * chrome://tracing or ui.perfetto.dev.
+ * Use the PROFILE_SCOPE and PROFILE_FUNCTION macros rather than the class directly; define DISABLE_PROFILER
+ * to compile them out.
+ */
+class Profiler
+{
+public:
+    static const size_t kEventsPerThread = 16384;///< Size of the ring buffer of each thread.
+    static const size_t kHistoryFrames = 300;///< Frames kept for the statistics.
+
+    /**
+     * @brief Singleton instance.
+     */
+    static Profiler& GetInstance()
+    {
+        static Profiler instance;
+        return instance;
+    }
+
+    Profiler(Profiler const&) = delete;
+    Profiler& operator=(Profiler const&) = delete;
+
+    /**
+     * \brief Nanoseconds since the profiler started
+     */
+    static uint64_t Now()
+    {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    /**
+     * \brief Turn recording on or off at run time, on by default
+     * @param enabled whether scopes are recorded
+     */
+    void SetEnabled(bool enabled)
+    {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Whether scopes are recorded
+     */
+    bool IsEnabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Name the calling thread in exported traces
+     * @param name name of the thread, copied
+     */
+    void SetThreadName(std::string const& name)
+    {
+        ThreadBuffer& buffer = LocalBuffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        buffer.name = name;
+    }
+
+    /**
+     * \brief Record a finished scope on the calling thread
+     * @param name name of the scope, must outlive the profiler
+     * @param start time the scope was entered, from Now()
+     * @param end time the scope was left, from Now()
+     * @param depth number of scopes open around it
+     */
+    void Record(const char* name, uint64_t start, uint64_t end, uint32_t depth)
+    {
+        ThreadBuffer& buffer = LocalBuffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        ProfileEvent& event = buffer.events[buffer.written % kEventsPerThread];
+        event.name = name;
+        event.start = start;
+        event.end = end;
+        event.depth = depth;
+        ++buffer.written;
+    }
+
+    /**
+     * \brief Number of scopes open on the calling thread
+     */
+    static uint32_t& Depth()
+    {
+        static thread_local uint32_t depth = 0;
+        return depth;
+    }
+
+    /**
+     * \brief Close the current frame
+     * Records the frame itself as the scope "Frame", then adds the time of every scope recorded since the last
+     * call to the history of its name. Call it once per frame, from one thread. The sums are gathered in the
+     * frame arena, so a steady frame allocates nothing here.
+     */
+    void EndFrame()
+    {
+        uint64_t now = Now();
+        if(m_frameStart != 0 && IsEnabled())
+        {
+            Record("Frame", m_frameStart, now, 0);
+        }
+        m_frameStart = now;
+
+        FrameHashMap<const char*, uint64_t, NameHash, NameEqual> frameTotals;
+        {
+            std::lock_guard<std::mutex> lock(m_buffersMutex);
+            for(std::unique_ptr<ThreadBuffer> const& buffer : m_buffers)
+            {
+                std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+                uint64_t first = buffer->written > kEventsPerThread ? buffer->written - kEventsPerThread : 0;
+                for(uint64_t i = std::max(first, buffer->aggregated); i < buffer->written; ++i)
+                {
+                    ProfileEvent const& event = buffer->events[i % kEventsPerThread];
+                    frameTotals[event.name] += event.end - event.start;
+                }
+                buffer->aggregated = buffer->written;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_historyMutex);
+        for(std::pair<const char* const, uint64_t> const& total : frameTotals)
+        {
+            History& history = m_history[total.first];
+            if(history.frameMs.empty())
+            {
+                history.frameMs.resize(kHistoryFrames);
+            }
+            history.frameMs[history.next] = static_cast<float>(total.second / 1000000.0);
+            history.next = (history.next + 1) % kHistoryFrames;
+            history.count = history.count < kHistoryFrames ? history.count + 1 : kHistoryFrames;
+        }
+    }
+
+    /**
+     * \brief Get the statistics of a scope over the recent frames
+     * @param name name of the scope
+     * @return statistics, all zero if the scope never ran
+     */
+    ProfileStats GetStats(std::string const& name) const
+    {
+        ProfileStats stats;
+        std::vector<float> samples;
+        {
+            std::lock_guard<std::mutex> lock(m_historyMutex);
+            HistoryMap::const_iterator it = m_history.find(name.c_str());
+            if(it == m_history.end() || it->second.count == 0)
+            {
+                return stats;
+            }
+            samples.assign(it->second.frameMs.begin(), it->second.frameMs.begin() + it->second.count);
+        }
+        std::sort(samples.begin(), samples.end());
+        double sum = 0.0;
+        for(float sample : samples)
+        {
+            sum += sample;
+        }
+        stats.frames = static_cast<int>(samples.size());
+        stats.minMs = samples.front();
+        stats.maxMs = samples.back();
+        stats.avgMs = static_cast<float>(sum / samples.size());
+        stats.p99Ms = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+        return stats;
+    }
+
+    /**
+     * \brief Forget the statistics of every scope, the events in the ring buffers are kept
+     */
+    void ResetStats()
+    {
+        std::lock_guard<std::mutex> lock(m_historyMutex);
+        m_history.clear();
+    }
+
+    /**
+     * \brief Get the names of every scope that has statistics
+     */
+    std::vector<std::string> GetScopeNames() const
+    {
+        std::vector<std::string> names;
+        std::lock_guard<std::mutex> lock(m_historyMutex);
+        for(std::pair<const char* const, History> const& history : m_history)
+        {
+            names.push_back(history.first);
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    /**
+     * \brief Write the events in the ring buffers as a Chrome trace event file
+     * @param path file to write
+     * @return false if the file could not be written
+     */
+    bool ExportChromeTrace(std::string const& path) const
+    {
+        FILE* file = std::fopen(path.c_str(), "w");
+        if(!file)
+        {
+            std::printf("Could not write the profile to %s\n", path.c_str());
+            return false;
+        }
+        std::fputs("{\"traceEvents\":[\n", file);
+        bool first = true;
+        std::lock_guard<std::mutex> lock(m_buffersMutex);
+        for(std::unique_ptr<ThreadBuffer> const& buffer : m_buffers)
+        {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"",
+                         first ? "" : ",\n", buffer->id);
+            WriteEscaped(file, buffer->name.c_str());
+            std::fputs("\"}}", file);
+            first = false;
+            uint64_t begin = buffer->written > kEventsPerThread ? buffer->written - kEventsPerThread : 0;
+            for(uint64_t i = begin; i < buffer->written; ++i)
+            {
+                ProfileEvent const& event = buffer->events[i % kEventsPerThread];
+                std::fputs(",\n{\"name\":\"", file);
+                WriteEscaped(file, event.name);
+                std::fprintf(file, "\",\"cat\":\"engine\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                             buffer->id, event.start / 1000.0, (event.end - event.start) / 1000.0);
+            }
+        }
+        std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+        bool written = std::ferror(file) == 0;
+        written = std::fclose(file) == 0 && written;
+        return written;
+    }
+
+private:
+    /**
+     * @struct ThreadBuffer
+     * @brief ring buffer of one thread
+     * Only its thread writes to it; the mutex is taken by other threads only while a frame is closed or a trace
+     * exported, so it is uncontended otherwise.
+     */
+    struct ThreadBuffer
+    {
+        std::mutex mutex;
+        std::vector<ProfileEvent> events;
+        uint64_t written = 0;///< Events recorded since the start, the next goes to written % kEventsPerThread.
+        uint64_t aggregated = 0;///< Value of written at the last EndFrame.
+        uint32_t id = 0;///< Thread id in traces.
+        std::string name;///< Thread name in traces.
+    };
+
+    /**
+     * @struct NameHash
+     * @brief hash of the text of a scope name, the same name may be different literals in different files
+     */
+    struct NameHash
+    {
+        size_t operator()(const char* name) const
+        {
+            size_t hash = 14695981039346656037ull;
+            for(const char* c = name; *c; ++c)
+            {
+                hash = (hash ^ static_cast<unsigned char>(*c)) * 1099511628211ull;
+            }
+            return hash;
+        }
+    };
+
+    /**
+     * @struct NameEqual
+     * @brief comparison of the text of scope names
+     */
+    struct NameEqual
+    {
+        bool operator()(const char* a, const char* b) const
+        {
+            return a == b || std::strcmp(a, b) == 0;
+        }
+    };
+
+    /**
+     * @struct History
+     * @brief per frame totals of one scope name
+     */
+    struct History
+    {
+        std::vector<float> frameMs;///< Ring of frame totals in milliseconds.
+        size_t next = 0;///< Slot of the next total.
+        size_t count = 0;///< Number of valid totals.
+    };
+
+    typedef std::unordered_map<const char*, History, NameHash, NameEqual> HistoryMap;
+
+    Profiler()
+    {
+        Now();
+    }
+
+    /**
+     * \brief Ring buffer of the calling thread, created the first time the thread records
+     * Buffers are owned by the profiler and outlive their threads, so events of finished threads are still exported.
+     */
+    ThreadBuffer& LocalBuffer()
+    {
+        static thread_local ThreadBuffer* local = nullptr;
+        if(!local)
+        {
+            std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+            buffer->events.resize(kEventsPerThread);
+            std::lock_guard<std::mutex> lock(m_buffersMutex);
+            buffer->id = static_cast<uint32_t>(m_buffers.size());
+            buffer->name = buffer->id == 0 ? "Main" : "Thread " + std::to_string(buffer->id);
+            local = buffer.get();
+            m_buffers.push_back(std::move(buffer));
+        }
+        return *local;
+    }
+
+    /**
+     * \brief Write a string inside JSON quotes
+     */
+    static void WriteEscaped(FILE* file, const char* text)
+    {
+        for(const char* c = text; *c; ++c)
+        {
+            if(*c == '"' || *c == '\\')
+            {
+                std::fputc('\\', file);
+                std::fputc(*c, file);
+            }
+            else if(static_cast<unsigned char>(*c) < 0x20)
+            {
+                std::fprintf(file, "\\u%04x", static_cast<unsigned>(*c));
+            }
+            else
+            {
+                std::fputc(*c, file);
+            }
+        }
+    }
+
+    std::atomic<bool> m_enabled{true};///< Whether scopes are recorded.
+    mutable std::mutex m_buffersMutex;///< Guards m_buffers.
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;///< Ring buffer of every thread that recorded.
+    uint64_t m_frameStart = 0;///< Time of the last EndFrame.
+    mutable std::mutex m_historyMutex;///< Guards m_history.
+    HistoryMap m_history;///< Recent frame totals by scope name, keyed by the recorded names so no string is copied.
+};
+
+/**
+ * @class ProfileScope
+ * @brief Times the block it lives in and records it when the block is left.
+ */
+class ProfileScope
+{
+public:
+    /**
+     * \brief Constructor, starts the timer
+     * @param name name of the scope, must outlive the profiler (a string literal)
+     */
+    explicit ProfileScope(const char* name)
+    : m_name(name), m_active(Profiler::GetInstance().IsEnabled())
+    {
+        if(m_active)
+        {
+            m_depth = Profiler::Depth()++;
+            m_start = Profiler::Now();
+        }
+    }
+
+    ProfileScope(ProfileScope const&) = delete;
+    ProfileScope& operator=(ProfileScope const&) = delete;
+
+    /**
+     * \brief Destructor, records the scope
+     */
+    ~ProfileScope()
+    {
+        if(m_active)
+        {
+            uint64_t end = Profiler::Now();
+            --Profiler::Depth();
+            Profiler::GetInstance().Record(m_name, m_start, end, m_depth);
+        }
+    }
+
+private:
+    const char* m_name;///< Name of the scope.
+    bool m_active;///< Whether the profiler was enabled when the scope opened.
+    uint32_t m_depth = 0;///< Scopes open around this one.
+    uint64_t m_start = 0;///< Time the scope opened.
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if defined(DISABLE_PROFILER)
+    #define PROFILE_SCOPE(name) ((void)0)
+    #define PROFILE_FUNCTION() ((void)0)
+#else
+    /// Time the rest of the enclosing block under a name, which must be a string literal or otherwise outlive the program.
+    #define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+    /// Time the rest of the enclosing function under its name.
+    #define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#endif
+
+#endif /* Profiler_hpp */
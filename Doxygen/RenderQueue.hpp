@@ -0,0 +1,440 @@
+#ifndef RenderQueue_hpp
+#define RenderQueue_hpp
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#elif defined(__APPLE__)
+    #include <SDL2/SDL.h>
+#else
+    #include <SDL.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct SpriteCommand
+ * @brief One textured quad waiting to be drawn.
+ */
+struct SpriteCommand
+{
+    SDL_Texture* texture = nullptr;///< Texture to sample.
+    SDL_Rect src{0, 0, 0, 0};///< Part of the texture to draw.
+    SDL_Rect dst{0, 0, 0, 0};///< Where to draw it on the screen.
+    int layer = 0;///< Sorting layer, higher layers are drawn on top.
+    uint32_t order = 0;///< Index of the command in its frame, set by RenderQueue::Submit.
+    bool screenSpace = false;///< Whether dst is in screen pixels even with a view set, for UI; never culled.
+};
+
+/**
+ * @brief Smallest zoom a RenderView uses, a smaller or zero zoom is raised to it.
+ */
+const float kMinViewZoom = 0.01f;
+
+/**
+ * @struct RenderView
+ * @brief Part of the world shown on screen, usually made by a Camera.
+ */
+struct RenderView
+{
+    float x = 0.0f;///< World position shown at the center of the viewport.
+    float y = 0.0f;///< World position shown at the center of the viewport.
+    float zoom = 1.0f;///< Screen pixels per world unit, at least kMinViewZoom when used.
+    SDL_Rect viewport{0, 0, 0, 0};///< Area of the screen drawn to.
+
+    /**
+     * \brief Zoom actually used, never below kMinViewZoom, so no conversion divides by zero
+     */
+    float GetZoom() const
+    {
+        return zoom > kMinViewZoom ? zoom : kMinViewZoom;
+    }
+
+    /**
+     * \brief Part of the world that is visible
+     */
+    SDL_Rect GetWorldBounds() const
+    {
+        float scale = GetZoom();
+        float halfWidth = viewport.w * 0.5f / scale;
+        float halfHeight = viewport.h * 0.5f / scale;
+        return SDL_Rect{static_cast<int>(std::floor(x - halfWidth)), static_cast<int>(std::floor(y - halfHeight)),
+                        static_cast<int>(std::ceil(2.0f * halfWidth)) + 1, static_cast<int>(std::ceil(2.0f * halfHeight)) + 1};
+    }
+
+    /**
+     * \brief Whether a world rect overlaps the visible part of the world
+     */
+    bool IsVisible(SDL_Rect const& world) const
+    {
+        SDL_Rect bounds = GetWorldBounds();
+        return world.x < bounds.x + bounds.w && world.x + world.w > bounds.x
+            && world.y < bounds.y + bounds.h && world.y + world.h > bounds.y;
+    }
+
+    /**
+     * \brief Convert a world rect to screen pixels
+     */
+    SDL_Rect WorldToScreen(SDL_Rect const& world) const
+    {
+        float scale = GetZoom();
+        float left = viewport.x + viewport.w * 0.5f + (world.x - x) * scale;
+        float top = viewport.y + viewport.h * 0.5f + (world.y - y) * scale;
+        float right = viewport.x + viewport.w * 0.5f + (world.x + world.w - x) * scale;
+        float bottom = viewport.y + viewport.h * 0.5f + (world.y + world.h - y) * scale;
+        int screenX = static_cast<int>(std::floor(left));
+        int screenY = static_cast<int>(std::floor(top));
+        return SDL_Rect{screenX, screenY,
+                        static_cast<int>(std::floor(right)) - screenX, static_cast<int>(std::floor(bottom)) - screenY};
+    }
+};
+
+/**
+ * @struct RenderStats
+ * @brief Counters of the last flushed frame.
+ */
+struct RenderStats
+{
+    int sprites = 0;///< Sprites submitted and visible.
+    int culled = 0;///< Sprites submitted but outside the view.
+    int batches = 0;///< Runs of sprites sharing layer and texture.
+    int drawCalls = 0;///< Calls made into the SDL renderer.
+};
+
+/**
+ * @class RenderQueue
+ * @brief Collects sprite commands during a frame and draws them in as few calls as possible.
+ * @details Commands are sorted by layer, keeping submission order inside a layer. A sprite then joins an earlier
+ * batch of its texture in the same layer when it overlaps none of the batches in between, looking back at most
+ * kBatchLookback batches, so overlapping sprites are always drawn in submission order. Each batch is sent with
+ * SDL_RenderGeometry, split every kMaxSpritesPerCall sprites.
+ */
+class RenderQueue
+{
+public:
+    static const int kMaxSpritesPerCall = 8192;///< Upper bound of quads in one geometry call.
+    static const int kBatchLookback = 16;///< Batches a sprite may be moved back over to join one of its texture.
+
+    /**
+     * \brief Queue a sprite for this frame
+     * With a view set, dst is in world units: sprites outside the view are dropped and the others are
+     * converted to screen pixels. Without a view, or for a screenSpace command, dst is already in screen pixels.
+     * @param command sprite to draw
+     */
+    void Submit(SpriteCommand const& command)
+    {
+        if(!command.texture)
+        {
+            return;
+        }
+        if(!m_hasView || command.screenSpace)
+        {
+            m_commands.push_back(command);
+            m_commands.back().order = static_cast<uint32_t>(m_commands.size() - 1);
+            return;
+        }
+        if(!IsVisible(command.dst))
+        {
+            ++m_culled;
+            return;
+        }
+        m_commands.push_back(command);
+        m_commands.back().dst = m_view.WorldToScreen(command.dst);
+        m_commands.back().order = static_cast<uint32_t>(m_commands.size() - 1);
+    }
+
+    /**
+     * \brief Whether a sprite would survive culling, so callers can skip preparing sprites that would be dropped
+     * @param dst destination of the sprite, in world units
+     * @return true if it overlaps the view or no view is set
+     */
+    bool IsVisible(SDL_Rect const& dst) const
+    {
+        return !m_hasView || (dst.x < m_viewBounds.x + m_viewBounds.w && dst.x + dst.w > m_viewBounds.x
+                              && dst.y < m_viewBounds.y + m_viewBounds.h && dst.y + dst.h > m_viewBounds.y);
+    }
+
+    /**
+     * \brief Set the part of the world that sprites are culled against and drawn from
+     * @param view visible part of the world
+     */
+    void SetView(RenderView const& view)
+    {
+        m_view = view;
+        m_viewBounds = view.GetWorldBounds();
+        m_hasView = true;
+    }
+
+    /**
+     * \brief Get the world bounds sprites are culled against
+     * @return the bounds, nullptr if no view is set
+     */
+    SDL_Rect const* GetViewBounds() const
+    {
+        return m_hasView ? &m_viewBounds : nullptr;
+    }
+
+    /**
+     * \brief Go back to sprites given in screen pixels without culling
+     */
+    void ClearView()
+    {
+        m_hasView = false;
+    }
+
+    /**
+     * \brief Sort and draw every queued sprite, then empty the queue
+     * Falls back to one SDL_RenderCopy per sprite if the renderer does not support geometry.
+     * @param renderer target renderer
+     */
+    void Flush(SDL_Renderer* renderer)
+    {
+        SortCommands();
+        size_t begin = 0;
+        while(begin < m_commands.size())
+        {
+            size_t end = begin + 1;
+            while(end < m_commands.size()
+                  && m_commands[end].layer == m_commands[begin].layer
+                  && m_commands[end].texture == m_commands[begin].texture)
+            {
+                ++end;
+            }
+            ++m_stats.batches;
+            DrawRun(renderer, begin, end);
+            begin = end;
+        }
+        m_commands.clear();
+    }
+
+    /**
+     * \brief Sort every queued sprite and hand them to another drawer, then empty the queue
+     * For backends that do not draw through an SDL renderer, like SoftwareRasterizer. drawCalls stays 0.
+     * @param draw called once as draw(commands) with the sprites in drawing order, in screen pixels
+     */
+    template <typename Function>
+    void FlushTo(Function draw)
+    {
+        SortCommands();
+        for(size_t i = 0; i < m_commands.size(); ++i)
+        {
+            if(i == 0 || m_commands[i].layer != m_commands[i - 1].layer
+               || m_commands[i].texture != m_commands[i - 1].texture)
+            {
+                ++m_stats.batches;
+            }
+        }
+        draw(static_cast<std::vector<SpriteCommand> const&>(m_commands));
+        m_commands.clear();
+    }
+
+    /**
+     * \brief Exchange the queued sprites and the count of culled ones with another list, without copying
+     * Used to move a frame's sprites between the update and render threads, so the sprites culled on the update
+     * thread are reported in the stats of the flush that draws the frame.
+     * @param commands list to exchange with
+     * @param culled count of culled sprites to exchange with
+     */
+    void Swap(std::vector<SpriteCommand>& commands, int& culled)
+    {
+        m_commands.swap(commands);
+        std::swap(m_culled, culled);
+    }
+
+    /**
+     * \brief Get the counters of the last flush
+     */
+    RenderStats const& GetStats() const
+    {
+        return m_stats;
+    }
+
+private:
+    /**
+     * @struct Batch
+     * @brief sprites of one texture drawn together, with the area they cover
+     */
+    struct Batch
+    {
+        SDL_Texture* texture;
+        SDL_Rect bounds;
+        uint32_t size;
+    };
+
+    /**
+     * \brief Reset the counters and put the queued sprites in drawing order, see the class details
+     */
+    void SortCommands()
+    {
+        m_stats = RenderStats();
+        m_stats.sprites = static_cast<int>(m_commands.size());
+        m_stats.culled = m_culled;
+        m_culled = 0;
+
+        // Submission order breaks ties, so an unstable sort keeps layers in order without the buffer of stable_sort.
+        std::sort(m_commands.begin(), m_commands.end(),
+                  [](SpriteCommand const& a, SpriteCommand const& b)
+                  {
+                      return a.layer != b.layer ? a.layer < b.layer : a.order < b.order;
+                  });
+
+        // Batches are created in drawing order, so grouping the sprites by batch index gives the final order.
+        m_batches.clear();
+        m_batchOf.resize(m_commands.size());
+        size_t layerBegin = 0;
+        for(size_t i = 0; i < m_commands.size(); ++i)
+        {
+            SpriteCommand const& command = m_commands[i];
+            if(i > 0 && command.layer != m_commands[i - 1].layer)
+            {
+                layerBegin = m_batches.size();
+            }
+            size_t target = m_batches.size();
+            size_t lookback = std::min(m_batches.size() - layerBegin, static_cast<size_t>(kBatchLookback));
+            size_t stop = m_batches.size() - lookback;
+            for(size_t b = m_batches.size(); b > stop; --b)
+            {
+                Batch const& batch = m_batches[b - 1];
+                if(batch.texture == command.texture)
+                {
+                    target = b - 1;
+                    break;
+                }
+                if(Overlaps(batch.bounds, command.dst))
+                {
+                    break;
+                }
+            }
+            if(target == m_batches.size())
+            {
+                m_batches.push_back(Batch{command.texture, command.dst, 0});
+            }
+            else
+            {
+                m_batches[target].bounds = Union(m_batches[target].bounds, command.dst);
+            }
+            ++m_batches[target].size;
+            m_batchOf[i] = static_cast<uint32_t>(target);
+        }
+        if(m_batches.size() == m_commands.size())
+        {
+            return;
+        }
+        uint32_t first = 0;
+        for(Batch& batch : m_batches)
+        {
+            uint32_t size = batch.size;
+            batch.size = first;
+            first += size;
+        }
+        m_sorted.resize(m_commands.size());
+        for(size_t i = 0; i < m_commands.size(); ++i)
+        {
+            m_sorted[m_batches[m_batchOf[i]].size++] = m_commands[i];
+        }
+        m_commands.swap(m_sorted);
+    }
+
+    /**
+     * \brief Whether two rects share some area, touching edges do not count
+     */
+    static bool Overlaps(SDL_Rect const& a, SDL_Rect const& b)
+    {
+        return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+    }
+
+    /**
+     * \brief Smallest rect containing two rects
+     */
+    static SDL_Rect Union(SDL_Rect const& a, SDL_Rect const& b)
+    {
+        int left = std::min(a.x, b.x);
+        int top = std::min(a.y, b.y);
+        int right = std::max(a.x + a.w, b.x + b.w);
+        int bottom = std::max(a.y + a.h, b.y + b.h);
+        return SDL_Rect{left, top, right - left, bottom - top};
+    }
+
+    /**
+     * \brief Draw sprites [begin, end) which all share one texture
+     */
+    void DrawRun(SDL_Renderer* renderer, size_t begin, size_t end)
+    {
+        SDL_Texture* texture = m_commands[begin].texture;
+        int width = 0;
+        int height = 0;
+        SDL_QueryTexture(texture, nullptr, nullptr, &width, &height);
+        float invWidth = width > 0 ? 1.0f / width : 0.0f;
+        float invHeight = height > 0 ? 1.0f / height : 0.0f;
+
+        for(size_t first = begin; first < end; first += kMaxSpritesPerCall)
+        {
+            size_t last = std::min(end, first + kMaxSpritesPerCall);
+            m_vertices.clear();
+            m_indices.clear();
+            for(size_t i = first; i < last; ++i)
+            {
+                AppendQuad(m_commands[i], invWidth, invHeight);
+            }
+            ++m_stats.drawCalls;
+            if(SDL_RenderGeometry(renderer, texture,
+                                  m_vertices.data(), static_cast<int>(m_vertices.size()),
+                                  m_indices.data(), static_cast<int>(m_indices.size())) != 0)
+            {
+                --m_stats.drawCalls;
+                for(size_t i = first; i < last; ++i)
+                {
+                    SDL_RenderCopy(renderer, texture, &m_commands[i].src, &m_commands[i].dst);
+                    ++m_stats.drawCalls;
+                }
+            }
+        }
+    }
+
+    /**
+     * \brief Append the four vertices and six indices of a sprite
+     */
+    void AppendQuad(SpriteCommand const& command, float invWidth, float invHeight)
+    {
+        int base = static_cast<int>(m_vertices.size());
+        float x0 = static_cast<float>(command.dst.x);
+        float y0 = static_cast<float>(command.dst.y);
+        float x1 = x0 + command.dst.w;
+        float y1 = y0 + command.dst.h;
+        float u0 = command.src.x * invWidth;
+        float v0 = command.src.y * invHeight;
+        float u1 = (command.src.x + command.src.w) * invWidth;
+        float v1 = (command.src.y + command.src.h) * invHeight;
+        SDL_Color white{255, 255, 255, 255};
+
+        m_vertices.push_back(SDL_Vertex{SDL_FPoint{x0, y0}, white, SDL_FPoint{u0, v0}});
+        m_vertices.push_back(SDL_Vertex{SDL_FPoint{x1, y0}, white, SDL_FPoint{u1, v0}});
+        m_vertices.push_back(SDL_Vertex{SDL_FPoint{x1, y1}, white, SDL_FPoint{u1, v1}});
+        m_vertices.push_back(SDL_Vertex{SDL_FPoint{x0, y1}, white, SDL_FPoint{u0, v1}});
+
+        m_indices.push_back(base);
+        m_indices.push_back(base + 1);
+        m_indices.push_back(base + 2);
+        m_indices.push_back(base);
+        m_indices.push_back(base + 2);
+        m_indices.push_back(base + 3);
+    }
+
+    std::vector<SpriteCommand> m_commands;///< Sprites queued this frame.
+    std::vector<SpriteCommand> m_sorted;///< Scratch list the sprites are grouped into by batch, reused every flush.
+    std::vector<Batch> m_batches;///< Batches of the flush being sorted; during grouping, size is the next slot.
+    std::vector<uint32_t> m_batchOf;///< Batch of each sorted sprite.
+    std::vector<SDL_Vertex> m_vertices;///< Scratch vertex buffer, reused every call.
+    std::vector<int> m_indices;///< Scratch index buffer, reused every call.
+    RenderStats m_stats;///< Counters of the last flush.
+    RenderView m_view;///< View sprites are culled against.
+    SDL_Rect m_viewBounds{0, 0, 0, 0};///< World bounds of m_view, computed once per SetView.
+    bool m_hasView = false;///< Whether m_view is used.
+    int m_culled = 0;///< Sprites culled since the last flush.
+};
+
+#endif /* RenderQueue_hpp */
@@ -24,15 +24,40 @@
 #include <fstream>
 #include <ostream>
 #include <map>
+#include <mutex>
+#include <vector>
 
 #include "document.h"
 #include "filereadstream.h"
+#include "TextureAtlas.hpp"
+#include "AsyncLoader.hpp"
+#include "AssetTable.hpp"
+#include "CookedScene.hpp"
+#include "AnimationLibrary.hpp"
+#include "FramePipeline.hpp"
 
 using namespace rapidjson;
 
+class SoftwareRasterizer;
+
+/**
+ * @brief Interned handle of a texture.
+ */
+typedef AssetHandle<SDL_Texture> TextureHandle;
+
+/**
+ * @brief Interned handle of a music.
+ */
+typedef AssetHandle<Mix_Chunk> MusicHandle;
+
 /**
  * @class ResourceManager
  * @brief manager of all kind of reasources.
+ * @details When frames are pipelined, the functions that create or free SDL textures and sounds are recorded
+ * through the render thread dispatch when called from another thread, and run on the render thread with the frame
+ * that called them: the asset can be used once that frame is drawn. Looking an asset up by handle takes no lock:
+ * the render thread publishes loaded assets into their AssetTable slot atomically. Only lookups by path and the
+ * atlas regions take a mutex, so per frame code keeps handles.
  */
 class ResourceManager
 {
@@ -50,53 +75,235 @@ public:
      * \brief Read and save .json file of the scene.
      * @param sceneJson path of the scene json file.
      */
-    void ReadSceneJson(std::string sceneJson);
+    void ReadSceneJson(std::string const& sceneJson);
     
     /**
      * \brief Read and save .json file of animations.
      * @param path path of the animation json file.
      */
-    void ReadAnimationJson(std::string path);
+    void ReadAnimationJson(std::string const& path);
+    
+    /**
+     * \brief Parse an animation file into the animation library, only the first time it is asked for
+     * The sprite sheet of the file is acquired with AcquireTexture once for each clip, and every animation becomes an
+     * immutable clip holding it; ClearAnimations releases them.
+     * @param path path of the animation json file
+     * @return set of the clips of the file, nullptr if the file could not be read
+     */
+    AnimationSet const* LoadAnimations(std::string const& path);
+    
+    /**
+     * \brief Get the clips of every animation file loaded so far
+     */
+    AnimationLibrary& GetAnimationLibrary()
+    {
+        return m_Animations;
+    }
+    
+    /**
+     * \brief Drop every clip of the animation library and release the sprite sheets they held
+     * Animators must not play them anymore; the sheets can then be freed by EvictUnusedAssets.
+     */
+    void ClearAnimations()
+    {
+        m_Animations.Clear([this](TextureHandle handle) { ReleaseTexture(handle); });
+    }
+    
+    /**
+     * \brief Cook a scene: convert its json, its tile csv and the animation json of its objects into one binary file
+     * This is the offline step; the game then loads the result with Engine::LoadCookedScene without parsing anything.
+     * Animation files shared by several objects are cooked once.
+     * @param sceneJson path of the scene json file
+     * @param cookedPath path of the cooked scene to write
+     * @return false if a source file could not be read or the result could not be written
+     */
+    bool CookScene(std::string const& sceneJson, std::string const& cookedPath);
     
     /**
      * \brief Get name of a certain resource.
      * @param path path of the resource
      * @return name of the resource
      */
-    std::string GetName(std::string path);
+    std::string GetName(std::string const& path);
     
     /**
      * \brief load a texture
+     * Off the render thread of pipelined frames, the load is deferred to the render thread, see the class details.
      * @param path path of the picture.
      */
-    void LoadTexture(std::string path);
+    void LoadTexture(std::string const& path);
     
     /**
      * \brief load a music
+     * Deferred like LoadTexture.
+     * @param path path of the music
+     */
+    void LoadMusic(std::string const& path);
+    
+    /**
+     * \brief load a texture in the background
+     * The picture is decoded on a worker thread and uploaded by UpdateAsyncLoads.
+     * @param path path of the picture.
+     * @return future of the texture, which is also stored for GetTextureByPath once ready
+     */
+    std::shared_future<SDL_Texture*> LoadTextureAsync(std::string const& path);
+    
+    /**
+     * \brief load a music in the background
      * @param path path of the music
+     * @return future of the music, which is also stored for GetMusicByPath once ready
      */
-    void LoadMusic(std::string path);
+    std::shared_future<Mix_Chunk*> LoadMusicAsync(std::string const& path);
+    
+    /**
+     * \brief finish assets loaded in the background, must be called on the render thread
+     * @param budgetMs time allowed for texture uploads in this call
+     * @return number of assets finished
+     */
+    int UpdateAsyncLoads(Uint32 budgetMs);
+    
+    /**
+     * \brief get the number of assets still loading in the background
+     * @return pending asset count, 0 when everything is loaded
+     */
+    int GetPendingLoadCount();
     
     /**
      * \brief get a texture
+     * The path is hashed on every call: code that runs every frame keeps a handle from AcquireTexture and uses
+     * GetTexture instead. The texture is not held, so it stays loaded only as long as it was never acquired or
+     * somebody still holds it.
      * @param path path to the picture
      * @return corresponding texture
      */
-    SDL_Texture* GetTextureByPath(std::string path);
+    SDL_Texture* GetTextureByPath(std::string const& path);
+    
+    /**
+     * \brief load many small pictures into shared atlas pages
+     * Pictures larger than a page are loaded as standalone textures. The padding around each picture is filled by
+     * ExtrudeAtlasPadding before the page is uploaded. Deferred like LoadTexture. Load the atlas before creating the sprites that use it: the
+     * sprites then draw from the pages, so those sharing a page batch into one draw call.
+     * @param paths paths of the pictures
+     * @param pageSize width and height of each atlas page
+     */
+    void LoadTextureAtlas(std::vector<std::string> const& paths, int pageSize = 2048);
+    
+    /**
+     * \brief get the texture and the rect that hold a picture
+     * For a picture in an atlas this is its page and sub-rect, otherwise its own texture and full size.
+     * The result can be passed to SpriteRenderer::SetSpriteDetail unchanged.
+     * @param path path to the picture
+     * @return corresponding region, with a null texture if the picture is not loaded
+     */
+    TextureRegion GetTextureRegionByPath(std::string const& path);
     
     /**
      * \brief get a music
      * @param path path to the music
      * @return corresponding music
      */
-    Mix_Chunk* GetMusicByPath(std::string path);
+    Mix_Chunk* GetMusicByPath(std::string const& path);
+    
+    /**
+     * \brief get a handle to a texture and hold it, loading the texture if needed
+     * Keep the handle and use GetTexture while running instead of looking the path up again.
+     * The handle is returned right away; a load deferred to the render thread fills it in later.
+     * @param path path to the picture
+     * @return handle of the texture
+     */
+    TextureHandle AcquireTexture(std::string const& path);
+    
+    /**
+     * \brief stop holding a texture, so EvictUnusedAssets may free it
+     * @param handle handle of the texture
+     */
+    void ReleaseTexture(TextureHandle handle);
+    
+    /**
+     * \brief get a texture from its handle, without locking, from the update or the render thread
+     * @param handle handle of the texture
+     * @return corresponding texture, nullptr if it is not loaded
+     */
+    SDL_Texture* GetTexture(TextureHandle handle) const
+    {
+        return m_Textures.Get(handle);
+    }
+    
+    /**
+     * \brief get a handle to a music and hold it, loading the music if needed
+     * @param path path to the music
+     * @return handle of the music
+     */
+    MusicHandle AcquireMusic(std::string const& path);
+    
+    /**
+     * \brief stop holding a music, so EvictUnusedAssets may free it
+     * @param handle handle of the music
+     */
+    void ReleaseMusic(MusicHandle handle);
+    
+    /**
+     * \brief get a music from its handle
+     * @param handle handle of the music
+     * @return corresponding music, nullptr if it is not loaded
+     */
+    Mix_Chunk* GetMusic(MusicHandle handle) const
+    {
+        return m_Chunks.Get(handle);
+    }
+    
+    /**
+     * \brief free the textures and musics that were acquired and that nobody holds anymore
+     * Assets loaded by path only, without AcquireTexture or AcquireMusic, are kept, since their raw pointers may
+     * still be in use. SpriteRenderer and TileMap hold the textures they draw, see their members.
+     * Off the render thread of pipelined frames, it is deferred as a retire command: it runs once the frame that
+     * called it is drawn, when no snapshot still in flight can draw a released texture.
+     * Textures are freed with DestroyTexture.
+     * @return number of freed assets, 0 when deferred
+     */
+    int EvictUnusedAssets();
+    
+    /**
+     * \brief free a texture, after removing its pixels from the software rasterizer if one is set
+     * Every texture the manager frees goes through it: evicted ones, atlas pages and everything left at destruction.
+     * A texture created outside the manager and registered with the rasterizer is freed with it too, or a later
+     * texture given the same address would be drawn with the old pixels.
+     * @param texture texture to free, nullptr does nothing
+     */
+    void DestroyTexture(SDL_Texture* texture);
+    
+    /**
+     * \brief register every texture created from now on with a software rasterizer
+     * Covers LoadTexture, asynchronous loads and atlas pages, whose surfaces are only kept until they are copied.
+     * DestroyTexture unregisters them again.
+     * @param rasterizer rasterizer drawing the frames, nullptr to stop
+     */
+    void SetSoftwareRasterizer(SoftwareRasterizer* rasterizer)
+    {
+        m_softwareRasterizer = rasterizer;
+    }
+    
+    /**
+     * \brief get the dispatch that defers loads to the render thread, attached by Engine::EnablePipelinedFrames
+     */
+    RenderThreadDispatch& GetRenderThreadDispatch()
+    {
+        return m_renderThreadDispatch;
+    }
     
     SDL_Renderer* m_renderer;///< Current renderer
 private:
     static ResourceManager* instance;///< Singleton instance
     
-    std::map<std::string, SDL_Texture*> m_TextureMap;///< All textures
-    std::map<std::string, Mix_Chunk*> m_ChunkMap;///< All musics.
+    AssetTable<SDL_Texture> m_Textures;///< All textures
+    std::map<std::string, TextureRegion> m_RegionMap;///< Pictures packed into atlas pages
+    std::vector<SDL_Texture*> m_AtlasPages;///< All atlas pages
+    AssetTable<Mix_Chunk> m_Chunks;///< All musics.
+    AnimationLibrary m_Animations;///< Clips of all animation files, shared by every animator.
+    AsyncLoader* m_asyncLoader = nullptr;///< Background loader, created on first asynchronous load.
+    SoftwareRasterizer* m_softwareRasterizer = nullptr;///< Rasterizer textures are registered with, if any.
+    RenderThreadDispatch m_renderThreadDispatch;///< Sends loads and frees made off the render thread to it.
+    mutable std::mutex m_assetMutex;///< Guards the path maps of the asset tables and the atlas regions.
 };
 
 
@@ -0,0 +1,538 @@
+/**
+ *@file SoftwareRasterizer.hpp
+ *@brief Sprite rasterizer drawing into a framebuffer in memory, for machines without a GPU
+ *@details Blending uses AVX2 or SSE2 when the compiler targets them (-mavx2, or any x86-64 build for SSE2), with a
+ *scalar loop for the remaining pixels and other targets, like the kernels of Vector2Batch.hpp.
+ */
+#ifndef SoftwareRasterizer_hpp
+#define SoftwareRasterizer_hpp
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#elif defined(__APPLE__)
+    #include <SDL2/SDL.h>
+#else
+    #include <SDL.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+#endif
+
+#include "RenderQueue.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+
+/**
+ * @enum SampleFilter
+ * @brief how textures are sampled when a sprite is scaled
+ */
+enum SampleFilter
+{
+    nearest,///< closest texel, sharp pixel art
+    bilinear///< weighted average of the four closest texels
+};
+
+/**
+ *@brief blend premultiplied pixels over a row of the framebuffer: dst = src + dst * (1 - src alpha)
+ *Pixels are in SDL_PIXELFORMAT_RGBA32, so alpha is the fourth byte of each pixel in memory.
+ *@param dst framebuffer pixels, updated
+ *@param src premultiplied pixels
+ *@param count number of pixels
+ */
+inline void BlendSpan(uint32_t* dst, uint32_t const* src, int count)
+{
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m256i max = _mm256_set1_epi16(255);
+    const __m256i round = _mm256_set1_epi16(128);
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+        __m256i alpha = _mm256_and_si256(s, alphaMask);
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alphaMask)) == -1)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), s);
+            continue;
+        }
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, zero)) == -1)
+        {
+            continue;
+        }
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dst + i));
+        __m256i sLow = _mm256_unpacklo_epi8(s, zero);
+        __m256i sHigh = _mm256_unpackhi_epi8(s, zero);
+        __m256i invLow = _mm256_sub_epi16(max, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(sLow, 0xFF), 0xFF));
+        __m256i invHigh = _mm256_sub_epi16(max, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(sHigh, 0xFF), 0xFF));
+        __m256i dLow = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), invLow), round);
+        __m256i dHigh = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), invHigh), round);
+        dLow = _mm256_srli_epi16(_mm256_add_epi16(dLow, _mm256_srli_epi16(dLow, 8)), 8);
+        dHigh = _mm256_srli_epi16(_mm256_add_epi16(dHigh, _mm256_srli_epi16(dHigh, 8)), 8);
+        __m256i result = _mm256_packus_epi16(_mm256_add_epi16(sLow, dLow), _mm256_add_epi16(sHigh, dHigh));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), result);
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m128i max = _mm_set1_epi16(255);
+    const __m128i round = _mm_set1_epi16(128);
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+        __m128i alpha = _mm_and_si128(s, alphaMask);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) == 0xFFFF)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), s);
+            continue;
+        }
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF)
+        {
+            continue;
+        }
+        __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(dst + i));
+        __m128i sLow = _mm_unpacklo_epi8(s, zero);
+        __m128i sHigh = _mm_unpackhi_epi8(s, zero);
+        __m128i invLow = _mm_sub_epi16(max, _mm_shufflehi_epi16(_mm_shufflelo_epi16(sLow, 0xFF), 0xFF));
+        __m128i invHigh = _mm_sub_epi16(max, _mm_shufflehi_epi16(_mm_shufflelo_epi16(sHigh, 0xFF), 0xFF));
+        __m128i dLow = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), invLow), round);
+        __m128i dHigh = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), invHigh), round);
+        dLow = _mm_srli_epi16(_mm_add_epi16(dLow, _mm_srli_epi16(dLow, 8)), 8);
+        dHigh = _mm_srli_epi16(_mm_add_epi16(dHigh, _mm_srli_epi16(dHigh, 8)), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packus_epi16(_mm_add_epi16(sLow, dLow), _mm_add_epi16(sHigh, dHigh)));
+    }
+#endif
+    for(; i < count; ++i)
+    {
+        uint8_t const* s = reinterpret_cast<uint8_t const*>(src + i);
+        uint8_t* d = reinterpret_cast<uint8_t*>(dst + i);
+        uint32_t inverse = 255u - s[3];
+        for(int channel = 0; channel < 4; ++channel)
+        {
+            uint32_t t = d[channel] * inverse + 128u;
+            uint32_t value = s[channel] + ((t + (t >> 8)) >> 8);
+            d[channel] = static_cast<uint8_t>(value > 255u ? 255u : value);
+        }
+    }
+}
+
+/**
+ *@brief mix two packed pixels channel by channel
+ *@param a pixel at weight 0
+ *@param b pixel at weight 256
+ *@param weight weight of b, from 0 to 256
+ */
+inline uint32_t LerpPixel(uint32_t a, uint32_t b, uint32_t weight)
+{
+    uint32_t inverse = 256u - weight;
+    uint32_t evens = (((a & 0x00FF00FFu) * inverse + (b & 0x00FF00FFu) * weight) >> 8) & 0x00FF00FFu;
+    uint32_t odds = ((((a >> 8) & 0x00FF00FFu) * inverse + ((b >> 8) & 0x00FF00FFu) * weight) >> 8) & 0x00FF00FFu;
+    return evens | (odds << 8);
+}
+
+/**
+ * @struct SoftwareTexture
+ * @brief Copy of a texture in memory, premultiplied by alpha.
+ */
+struct SoftwareTexture
+{
+    std::vector<uint32_t> pixels;///< Texels row by row, in SDL_PIXELFORMAT_RGBA32.
+    int width = 0;///< Width in texels.
+    int height = 0;///< Height in texels.
+};
+
+/**
+ * @class SoftwareRasterizer
+ * @brief Draws sorted sprite commands into a framebuffer in memory, tile by tile on the job system.
+ * @details The framebuffer is split into kTileSize x kTileSize tiles. Each sprite is first added to the list of
+ * every tile it covers, in draw order, then the tiles are rasterized in parallel; a tile only writes its own pixels,
+ * so no locking is needed and the result does not depend on the number of threads. A sprite row is sampled into a
+ * small buffer, then blended over the framebuffer row with BlendSpan.
+ * SDL textures cannot be read back, so the pixels of every texture drawn must be given to RegisterTexture.
+ */
+class SoftwareRasterizer
+{
+public:
+    static const int kTileSize = 64;///< Width and height of a tile in pixels.
+
+    /**
+     * \brief Constructor
+     * @param width width of the framebuffer
+     * @param height height of the framebuffer
+     */
+    SoftwareRasterizer(int width, int height)
+    {
+        Resize(width, height);
+    }
+
+    /**
+     * \brief Change the size of the framebuffer, which is cleared to transparent black
+     * @param width new width
+     * @param height new height
+     */
+    void Resize(int width, int height)
+    {
+        m_width = std::max(0, width);
+        m_height = std::max(0, height);
+        m_pixels.assign(static_cast<size_t>(m_width) * m_height, 0u);
+        m_tilesX = (m_width + kTileSize - 1) / kTileSize;
+        m_tilesY = (m_height + kTileSize - 1) / kTileSize;
+        m_bins.resize(static_cast<size_t>(m_tilesX) * m_tilesY);
+    }
+
+    /**
+     * \brief Give the pixels of a texture, straight alpha
+     * @param texture SDL texture the sprite commands refer to
+     * @param pixels texels row by row in SDL_PIXELFORMAT_RGBA32, pitch of width pixels
+     * @param width width of the texture
+     * @param height height of the texture
+     */
+    void RegisterTexture(SDL_Texture* texture, uint32_t const* pixels, int width, int height)
+    {
+        SoftwareTexture& copy = m_textures[texture];
+        copy.width = width;
+        copy.height = height;
+        copy.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height);
+        for(uint32_t& pixel : copy.pixels)
+        {
+            uint8_t* channels = reinterpret_cast<uint8_t*>(&pixel);
+            uint32_t alpha = channels[3];
+            for(int channel = 0; channel < 3; ++channel)
+            {
+                uint32_t t = channels[channel] * alpha + 128u;
+                channels[channel] = static_cast<uint8_t>((t + (t >> 8)) >> 8);
+            }
+        }
+    }
+
+    /**
+     * \brief Give the pixels of a texture from the surface it was created from
+     * @param texture SDL texture the sprite commands refer to
+     * @param surface surface of any format, left unchanged
+     * @return false if the surface could not be converted
+     */
+    bool RegisterTexture(SDL_Texture* texture, SDL_Surface* surface)
+    {
+        SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+        if(!converted)
+        {
+            return false;
+        }
+        SDL_LockSurface(converted);
+        std::vector<uint32_t> pixels(static_cast<size_t>(converted->w) * converted->h);
+        for(int y = 0; y < converted->h; ++y)
+        {
+            uint32_t const* row = reinterpret_cast<uint32_t const*>(static_cast<uint8_t const*>(converted->pixels)
+                                                                    + static_cast<size_t>(y) * converted->pitch);
+            std::copy(row, row + converted->w, pixels.begin() + static_cast<size_t>(y) * converted->w);
+        }
+        SDL_UnlockSurface(converted);
+        RegisterTexture(texture, pixels.data(), converted->w, converted->h);
+        SDL_FreeSurface(converted);
+        return true;
+    }
+
+    /**
+     * \brief Forget the pixels of a texture, call it before destroying the texture
+     * ResourceManager::DestroyTexture does it for the textures of the manager.
+     * @param texture SDL texture
+     */
+    void UnregisterTexture(SDL_Texture* texture)
+    {
+        m_textures.erase(texture);
+    }
+
+    /**
+     * \brief Set how scaled sprites are sampled
+     * @param filter sample filter
+     */
+    void SetFilter(SampleFilter filter)
+    {
+        m_filter = filter;
+    }
+
+    /**
+     * \brief Set the job system the tiles are spread over
+     * @param jobs job system, nullptr to rasterize on the calling thread
+     */
+    void SetJobSystem(JobSystem* jobs)
+    {
+        m_jobs = jobs;
+    }
+
+    /**
+     * \brief Clear the framebuffer before the next sprites, done by each tile as it is rasterized
+     * @param r red
+     * @param g green
+     * @param b blue
+     * @param a alpha
+     */
+    void Clear(Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+    {
+        uint8_t* channels = reinterpret_cast<uint8_t*>(&m_clearColor);
+        channels[0] = r;
+        channels[1] = g;
+        channels[2] = b;
+        channels[3] = a;
+        m_clearPending = true;
+    }
+
+    /**
+     * \brief Draw sprites in screen pixels, in the order given, as RenderQueue::FlushTo hands them
+     * Sprites whose texture was not registered are skipped.
+     * @param commands sorted sprites
+     */
+    void Draw(std::vector<SpriteCommand> const& commands)
+    {
+        PROFILE_SCOPE("SoftwareRasterizer::Draw");
+        m_commands = &commands;
+        m_resolved.resize(commands.size());
+        for(std::vector<uint32_t>& bin : m_bins)
+        {
+            bin.clear();
+        }
+        SDL_Texture* lastTexture = nullptr;
+        SoftwareTexture const* texture = nullptr;
+        for(size_t i = 0; i < commands.size(); ++i)
+        {
+            SpriteCommand const& command = commands[i];
+            if(command.texture != lastTexture)
+            {
+                lastTexture = command.texture;
+                std::unordered_map<SDL_Texture*, SoftwareTexture>::const_iterator it = m_textures.find(lastTexture);
+                texture = it == m_textures.end() ? nullptr : &it->second;
+            }
+            m_resolved[i] = texture;
+            if(!texture || command.dst.w <= 0 || command.dst.h <= 0)
+            {
+                continue;
+            }
+            int left = std::max(0, command.dst.x);
+            int top = std::max(0, command.dst.y);
+            int right = std::min(m_width, command.dst.x + command.dst.w);
+            int bottom = std::min(m_height, command.dst.y + command.dst.h);
+            if(left >= right || top >= bottom)
+            {
+                continue;
+            }
+            for(int ty = top / kTileSize; ty <= (bottom - 1) / kTileSize; ++ty)
+            {
+                for(int tx = left / kTileSize; tx <= (right - 1) / kTileSize; ++tx)
+                {
+                    m_bins[static_cast<size_t>(ty) * m_tilesX + tx].push_back(static_cast<uint32_t>(i));
+                }
+            }
+        }
+
+        size_t tileCount = m_bins.size();
+        if(m_jobs)
+        {
+            m_jobs->ParallelFor(tileCount, 2, [this](size_t begin, size_t end)
+                                {
+                                    for(size_t tile = begin; tile < end; ++tile)
+                                    {
+                                        RasterTile(tile);
+                                    }
+                                });
+        }
+        else
+        {
+            for(size_t tile = 0; tile < tileCount; ++tile)
+            {
+                RasterTile(tile);
+            }
+        }
+        m_clearPending = false;
+        m_commands = nullptr;
+    }
+
+    /**
+     * \brief Copy the framebuffer into a streaming texture of the same size and SDL_PIXELFORMAT_RGBA32
+     * @param texture destination texture
+     */
+    void UploadTo(SDL_Texture* texture) const
+    {
+        SDL_UpdateTexture(texture, nullptr, m_pixels.data(), GetPitch());
+    }
+
+    /**
+     * \brief Write the framebuffer to a BMP file
+     * @param path destination file
+     * @return false if the file could not be written
+     */
+    bool SaveBMP(std::string const& path) const
+    {
+        SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(const_cast<uint32_t*>(m_pixels.data()), m_width,
+                                                                  m_height, 32, GetPitch(), SDL_PIXELFORMAT_RGBA32);
+        if(!surface)
+        {
+            return false;
+        }
+        bool saved = SDL_SaveBMP(surface, path.c_str()) == 0;
+        SDL_FreeSurface(surface);
+        return saved;
+    }
+
+    /**
+     * \brief Pixels of the framebuffer row by row, in SDL_PIXELFORMAT_RGBA32 with premultiplied alpha
+     */
+    uint32_t const* GetPixels() const
+    {
+        return m_pixels.data();
+    }
+
+    /**
+     * \brief Bytes per row of the framebuffer
+     */
+    int GetPitch() const
+    {
+        return m_width * static_cast<int>(sizeof(uint32_t));
+    }
+
+    /**
+     * \brief Width of the framebuffer
+     */
+    int GetWidth() const
+    {
+        return m_width;
+    }
+
+    /**
+     * \brief Height of the framebuffer
+     */
+    int GetHeight() const
+    {
+        return m_height;
+    }
+
+private:
+    /**
+     * \brief Clear a tile if needed and draw the sprites binned to it
+     */
+    void RasterTile(size_t tile)
+    {
+        int tileX = static_cast<int>(tile % m_tilesX) * kTileSize;
+        int tileY = static_cast<int>(tile / m_tilesX) * kTileSize;
+        int tileSize = kTileSize;
+        SDL_Rect clip{tileX, tileY, std::min(tileSize, m_width - tileX), std::min(tileSize, m_height - tileY)};
+        if(m_clearPending)
+        {
+            for(int y = clip.y; y < clip.y + clip.h; ++y)
+            {
+                uint32_t* row = &m_pixels[static_cast<size_t>(y) * m_width + clip.x];
+                std::fill(row, row + clip.w, m_clearColor);
+            }
+        }
+        for(uint32_t index : m_bins[tile])
+        {
+            DrawSprite((*m_commands)[index], *m_resolved[index], clip);
+        }
+    }
+
+    /**
+     * \brief Draw the part of a sprite inside a tile
+     * Texel centers are mapped to pixel centers in 16.16 fixed point; the source rect is clamped to the texture.
+     */
+    void DrawSprite(SpriteCommand const& command, SoftwareTexture const& texture, SDL_Rect const& clip)
+    {
+        int srcX = std::max(0, command.src.x);
+        int srcY = std::max(0, command.src.y);
+        int srcW = std::min(texture.width, command.src.x + command.src.w) - srcX;
+        int srcH = std::min(texture.height, command.src.y + command.src.h) - srcY;
+        if(srcW <= 0 || srcH <= 0)
+        {
+            return;
+        }
+        SDL_Rect const& dst = command.dst;
+        int left = std::max(clip.x, dst.x);
+        int top = std::max(clip.y, dst.y);
+        int right = std::min(clip.x + clip.w, dst.x + dst.w);
+        int bottom = std::min(clip.y + clip.h, dst.y + dst.h);
+        if(left >= right || top >= bottom)
+        {
+            return;
+        }
+        int width = right - left;
+        int64_t stepU = (static_cast<int64_t>(srcW) << 16) / dst.w;
+        int64_t stepV = (static_cast<int64_t>(srcH) << 16) / dst.h;
+        uint32_t span[kTileSize];
+        int column0[kTileSize];
+
+        if(m_filter == nearest)
+        {
+            for(int x = 0; x < width; ++x)
+            {
+                int u = static_cast<int>(((left + x - dst.x) * stepU + stepU / 2) >> 16);
+                column0[x] = srcX + std::min(u, srcW - 1);
+            }
+            for(int y = top; y < bottom; ++y)
+            {
+                int v = static_cast<int>(((y - dst.y) * stepV + stepV / 2) >> 16);
+                int texelY = srcY + std::min(v, srcH - 1);
+                uint32_t const* row = &texture.pixels[static_cast<size_t>(texelY) * texture.width];
+                for(int x = 0; x < width; ++x)
+                {
+                    span[x] = row[column0[x]];
+                }
+                BlendSpan(&m_pixels[static_cast<size_t>(y) * m_width + left], span, width);
+            }
+            return;
+        }
+
+        int column1[kTileSize];
+        uint32_t weightU[kTileSize];
+        for(int x = 0; x < width; ++x)
+        {
+            int64_t u = std::min<int64_t>(std::max<int64_t>(0, (left + x - dst.x) * stepU + stepU / 2 - 0x8000),
+                                          static_cast<int64_t>(srcW - 1) << 16);
+            int texel = static_cast<int>(u >> 16);
+            column0[x] = srcX + texel;
+            column1[x] = srcX + std::min(texel + 1, srcW - 1);
+            weightU[x] = static_cast<uint32_t>((u >> 8) & 0xFF);
+        }
+        for(int y = top; y < bottom; ++y)
+        {
+            int64_t v = std::min<int64_t>(std::max<int64_t>(0, (y - dst.y) * stepV + stepV / 2 - 0x8000),
+                                          static_cast<int64_t>(srcH - 1) << 16);
+            int texel = static_cast<int>(v >> 16);
+            uint32_t weightV = static_cast<uint32_t>((v >> 8) & 0xFF);
+            int texelY1 = srcY + std::min(texel + 1, srcH - 1);
+            uint32_t const* row0 = &texture.pixels[static_cast<size_t>(srcY + texel) * texture.width];
+            uint32_t const* row1 = &texture.pixels[static_cast<size_t>(texelY1) * texture.width];
+            for(int x = 0; x < width; ++x)
+            {
+                uint32_t upper = LerpPixel(row0[column0[x]], row0[column1[x]], weightU[x]);
+                uint32_t lower = LerpPixel(row1[column0[x]], row1[column1[x]], weightU[x]);
+                span[x] = LerpPixel(upper, lower, weightV);
+            }
+            BlendSpan(&m_pixels[static_cast<size_t>(y) * m_width + left], span, width);
+        }
+    }
+
+    std::vector<uint32_t> m_pixels;///< Framebuffer, row by row.
+    int m_width = 0;///< Width of the framebuffer.
+    int m_height = 0;///< Height of the framebuffer.
+    int m_tilesX = 0;///< Columns of tiles.
+    int m_tilesY = 0;///< Rows of tiles.
+    std::vector<std::vector<uint32_t>> m_bins;///< Indices of the commands covering each tile, in draw order.
+    std::vector<SoftwareTexture const*> m_resolved;///< Texture of each command of the current draw.
+    std::vector<SpriteCommand> const* m_commands = nullptr;///< Commands of the current draw.
+    std::unordered_map<SDL_Texture*, SoftwareTexture> m_textures;///< Registered textures.
+    JobSystem* m_jobs = nullptr;///< Job system the tiles are spread over, if any.
+    SampleFilter m_filter = nearest;///< How scaled sprites are sampled.
+    uint32_t m_clearColor = 0;///< Color the tiles are cleared to.
+    bool m_clearPending = false;///< Whether the next draw clears the tiles first.
+};
+
+#endif /* SoftwareRasterizer_hpp */
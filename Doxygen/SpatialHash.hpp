@@ -0,0 +1,368 @@
+#ifndef SpatialHash_hpp
+#define SpatialHash_hpp
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class SpatialHash
+ * @brief Uniform grid of points for neighbourhood queries.
+ * @details Each item is a point stored in the bucket of the cell it lies in. Only cells holding items have a bucket:
+ * a bucket emptied by a move or a removal leaves the map and its storage is pooled for the next new cell. Moving an
+ * item touches the buckets only when it changes cell. A query visits the cells its area covers, or the occupied
+ * cells when they are fewer, so a huge area costs no more than the number of occupied cells. Coordinates are
+ * clamped to kMaxCell cells from the origin. Queries visit the items through a callback and never allocate.
+ * Pick a cell size close to the typical query radius.
+ */
+template <typename T>
+class SpatialHash
+{
+public:
+    static const uint32_t kInvalidId = 0xFFFFFFFFu;///< Id of no item.
+    static const int kMaxCell = 1 << 30;///< Largest cell coordinate, in both directions; NaN maps to -kMaxCell.
+
+    /**
+     * \brief Constructor
+     * @param cellSize width and height of a cell in world units
+     */
+    explicit SpatialHash(float cellSize = 128.0f)
+    : m_cellSize(cellSize), m_invCellSize(1.0f / cellSize)
+    {
+    }
+
+    /**
+     * \brief Add an item
+     * @param value item to store
+     * @param x position of the item
+     * @param y position of the item
+     * @return id of the item, used to move or remove it
+     */
+    uint32_t Insert(T const& value, float x, float y)
+    {
+        uint32_t id;
+        if(!m_freeIds.empty())
+        {
+            id = m_freeIds.back();
+            m_freeIds.pop_back();
+        }
+        else
+        {
+            id = static_cast<uint32_t>(m_items.size());
+            m_items.push_back(Item());
+        }
+        Item& item = m_items[id];
+        item.value = value;
+        item.x = x;
+        item.y = y;
+        item.alive = true;
+        AddToCell(id, CellKey(CellOf(x), CellOf(y)));
+        return id;
+    }
+
+    /**
+     * \brief Move an item
+     * @param id id of the item
+     * @param x new position
+     * @param y new position
+     */
+    void Move(uint32_t id, float x, float y)
+    {
+        Item& item = m_items[id];
+        item.x = x;
+        item.y = y;
+        uint64_t cell = CellKey(CellOf(x), CellOf(y));
+        if(cell != item.cell)
+        {
+            RemoveFromCell(id);
+            AddToCell(id, cell);
+        }
+    }
+
+    /**
+     * \brief Remove an item, its id may be given to a later item
+     * @param id id of the item
+     */
+    void Remove(uint32_t id)
+    {
+        RemoveFromCell(id);
+        m_items[id].alive = false;
+        m_freeIds.push_back(id);
+    }
+
+    /**
+     * \brief Visit every item within a distance of a point
+     * @param x center of the circle
+     * @param y center of the circle
+     * @param radius radius of the circle
+     * @param visit called as visit(value) for each item inside
+     */
+    template <typename Visit>
+    void QueryRadius(float x, float y, float radius, Visit visit) const
+    {
+        float radiusSquared = radius * radius;
+        ForEachInCells(x - radius, y - radius, x + radius, y + radius, [&](Item const& item)
+                       {
+                           float dx = item.x - x;
+                           float dy = item.y - y;
+                           if(dx * dx + dy * dy <= radiusSquared)
+                           {
+                               visit(item.value);
+                           }
+                       });
+    }
+
+    /**
+     * \brief Visit every item inside an axis-aligned box
+     * @param minX left edge
+     * @param minY top edge
+     * @param maxX right edge
+     * @param maxY bottom edge
+     * @param visit called as visit(value) for each item inside
+     */
+    template <typename Visit>
+    void QueryRect(float minX, float minY, float maxX, float maxY, Visit visit) const
+    {
+        ForEachInCells(minX, minY, maxX, maxY, [&](Item const& item)
+                       {
+                           if(item.x >= minX && item.x <= maxX && item.y >= minY && item.y <= maxY)
+                           {
+                               visit(item.value);
+                           }
+                       });
+    }
+
+    /**
+     * \brief Find the nearest item hit by a ray, treating every item as a circle
+     * Walks the grid cell by cell from the origin and stops as soon as no later cell can hold a nearer hit.
+     * @param x origin of the ray
+     * @param y origin of the ray
+     * @param dirX direction of the ray, normalized
+     * @param dirY direction of the ray, normalized
+     * @param maxDistance length of the ray
+     * @param itemRadius radius of the circle of every item, at most one cell size
+     * @param hit set to the nearest item hit
+     * @param distance set to the distance along the ray to the hit
+     * @return whether anything was hit
+     */
+    bool Raycast(float x, float y, float dirX, float dirY, float maxDistance, float itemRadius,
+                 T& hit, float& distance) const
+    {
+        int cellX = CellOf(x);
+        int cellY = CellOf(y);
+        int stepX = dirX > 0 ? 1 : (dirX < 0 ? -1 : 0);
+        int stepY = dirY > 0 ? 1 : (dirY < 0 ? -1 : 0);
+        float infinity = std::numeric_limits<float>::infinity();
+        float deltaX = stepX != 0 ? m_cellSize / std::fabs(dirX) : infinity;
+        float deltaY = stepY != 0 ? m_cellSize / std::fabs(dirY) : infinity;
+        float nextX = stepX > 0 ? ((cellX + 1) * m_cellSize - x) / dirX
+                    : (stepX < 0 ? (cellX * m_cellSize - x) / dirX : infinity);
+        float nextY = stepY > 0 ? ((cellY + 1) * m_cellSize - y) / dirY
+                    : (stepY < 0 ? (cellY * m_cellSize - y) / dirY : infinity);
+
+        float best = infinity;
+        float entry = 0.0f;
+        while(entry <= maxDistance && entry - itemRadius <= best)
+        {
+            // A circle may stick out of its cell, so check the neighbours of the cell the ray passes.
+            for(int oy = -1; oy <= 1; ++oy)
+            {
+                for(int ox = -1; ox <= 1; ++ox)
+                {
+                    VisitCell(CellKey(cellX + ox, cellY + oy), [&](Item const& item)
+                              {
+                                  float t;
+                                  if(RayCircle(x, y, dirX, dirY, item.x, item.y, itemRadius, t)
+                                     && t <= maxDistance && t < best)
+                                  {
+                                      best = t;
+                                      hit = item.value;
+                                  }
+                              });
+                }
+            }
+            if(nextX < nextY)
+            {
+                entry = nextX;
+                nextX += deltaX;
+                cellX += stepX;
+            }
+            else
+            {
+                entry = nextY;
+                nextY += deltaY;
+                cellY += stepY;
+            }
+            if(entry == infinity)
+            {
+                break;
+            }
+        }
+        distance = best;
+        return best != infinity;
+    }
+
+    /**
+     * \brief Number of items stored
+     */
+    size_t Size() const
+    {
+        return m_items.size() - m_freeIds.size();
+    }
+
+private:
+    /**
+     * @struct Item
+     * @brief a stored point
+     */
+    struct Item
+    {
+        T value = T();
+        float x = 0.0f;
+        float y = 0.0f;
+        uint64_t cell = 0;///< key of the cell holding the item
+        uint32_t slot = 0;///< index in the bucket of the cell
+        bool alive = false;
+    };
+
+    int CellOf(float v) const
+    {
+        float cell = std::floor(v * m_invCellSize);
+        if(!(cell > -static_cast<float>(kMaxCell)))
+        {
+            return -kMaxCell;
+        }
+        return cell < static_cast<float>(kMaxCell) ? static_cast<int>(cell) : kMaxCell;
+    }
+
+    static uint64_t CellKey(int cellX, int cellY)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32) | static_cast<uint32_t>(cellY);
+    }
+
+    void AddToCell(uint32_t id, uint64_t cell)
+    {
+        typename std::unordered_map<uint64_t, std::vector<uint32_t>>::iterator it = m_cells.find(cell);
+        if(it == m_cells.end())
+        {
+            it = m_cells.emplace(cell, std::vector<uint32_t>()).first;
+            if(!m_bucketPool.empty())
+            {
+                it->second.swap(m_bucketPool.back());
+                m_bucketPool.pop_back();
+            }
+        }
+        std::vector<uint32_t>& bucket = it->second;
+        m_items[id].cell = cell;
+        m_items[id].slot = static_cast<uint32_t>(bucket.size());
+        bucket.push_back(id);
+    }
+
+    void RemoveFromCell(uint32_t id)
+    {
+        typename std::unordered_map<uint64_t, std::vector<uint32_t>>::iterator it = m_cells.find(m_items[id].cell);
+        std::vector<uint32_t>& bucket = it->second;
+        uint32_t slot = m_items[id].slot;
+        bucket[slot] = bucket.back();
+        m_items[bucket[slot]].slot = slot;
+        bucket.pop_back();
+        if(bucket.empty())
+        {
+            m_bucketPool.push_back(std::vector<uint32_t>());
+            m_bucketPool.back().swap(bucket);
+            m_cells.erase(it);
+        }
+    }
+
+    template <typename Visit>
+    void VisitCell(uint64_t cell, Visit const& visit) const
+    {
+        typename std::unordered_map<uint64_t, std::vector<uint32_t>>::const_iterator it = m_cells.find(cell);
+        if(it == m_cells.end())
+        {
+            return;
+        }
+        for(uint32_t id : it->second)
+        {
+            visit(m_items[id]);
+        }
+    }
+
+    template <typename Visit>
+    void ForEachInCells(float minX, float minY, float maxX, float maxY, Visit visit) const
+    {
+        int firstX = CellOf(minX);
+        int firstY = CellOf(minY);
+        int lastX = CellOf(maxX);
+        int lastY = CellOf(maxY);
+        if(firstX > lastX || firstY > lastY)
+        {
+            return;
+        }
+        uint64_t area = static_cast<uint64_t>(static_cast<int64_t>(lastX) - firstX + 1)
+                      * static_cast<uint64_t>(static_cast<int64_t>(lastY) - firstY + 1);
+        if(area > m_cells.size())
+        {
+            for(typename std::unordered_map<uint64_t, std::vector<uint32_t>>::const_iterator it = m_cells.begin();
+                it != m_cells.end(); ++it)
+            {
+                int cellX = static_cast<int32_t>(static_cast<uint32_t>(it->first >> 32));
+                int cellY = static_cast<int32_t>(static_cast<uint32_t>(it->first));
+                if(cellX >= firstX && cellX <= lastX && cellY >= firstY && cellY <= lastY)
+                {
+                    for(uint32_t id : it->second)
+                    {
+                        visit(m_items[id]);
+                    }
+                }
+            }
+            return;
+        }
+        for(int cellY = firstY; cellY <= lastY; ++cellY)
+        {
+            for(int cellX = firstX; cellX <= lastX; ++cellX)
+            {
+                VisitCell(CellKey(cellX, cellY), visit);
+            }
+        }
+    }
+
+    /**
+     * \brief Distance along a ray to the first point of a circle, 0 if the origin is inside
+     */
+    static bool RayCircle(float x, float y, float dirX, float dirY, float cx, float cy, float radius, float& t)
+    {
+        float mx = x - cx;
+        float my = y - cy;
+        float c = mx * mx + my * my - radius * radius;
+        if(c <= 0.0f)
+        {
+            t = 0.0f;
+            return true;
+        }
+        float b = mx * dirX + my * dirY;
+        if(b > 0.0f)
+        {
+            return false;
+        }
+        float discriminant = b * b - c;
+        if(discriminant < 0.0f)
+        {
+            return false;
+        }
+        t = -b - std::sqrt(discriminant);
+        return true;
+    }
+
+    float m_cellSize;///< Size of a cell.
+    float m_invCellSize;///< 1 / m_cellSize.
+    std::vector<Item> m_items;///< Items indexed by id.
+    std::vector<uint32_t> m_freeIds;///< Ids of removed items.
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_cells;///< Item ids of each non-empty cell.
+    std::vector<std::vector<uint32_t>> m_bucketPool;///< Storage of emptied buckets, reused by new cells.
+};
+
+#endif /* SpatialHash_hpp */
@@ -0,0 +1,291 @@
+#ifndef TextureAtlas_hpp
+#define TextureAtlas_hpp
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#elif defined(__APPLE__)
+    #include <SDL2/SDL.h>
+#else
+    #include <SDL.h>
+#endif
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * @struct TextureRegion
+ * @brief A texture plus the part of it that holds one image.
+ * @details texture and rect can be passed straight to SpriteRenderer::SetSpriteDetail.
+ */
+struct TextureRegion
+{
+    SDL_Texture* texture = nullptr;///< Texture, usually an atlas page.
+    SDL_Rect rect{0, 0, 0, 0};///< Part of the texture holding the image.
+};
+
+/**
+ * @class SkylinePacker
+ * @brief Packs rectangles into one page with the skyline bottom-left heuristic.
+ * @details The top edge of the used area is kept as a list of horizontal segments. A new rectangle goes where
+ * its top edge ends up lowest, which leaves little wasted space for sprites of similar height.
+ */
+class SkylinePacker
+{
+public:
+    /**
+     * \brief Constructor
+     * @param width width of the page
+     * @param height height of the page
+     */
+    SkylinePacker(int width, int height)
+    : m_width(width), m_height(height)
+    {
+        Reset();
+    }
+
+    /**
+     * \brief Empty the page
+     */
+    void Reset()
+    {
+        m_skyline.clear();
+        m_skyline.push_back(Segment{0, 0, m_width});
+        m_usedArea = 0;
+    }
+
+    /**
+     * \brief Find a place for a rectangle and reserve it
+     * @param width width of the rectangle
+     * @param height height of the rectangle
+     * @param out position of the rectangle in the page
+     * @return false if the rectangle does not fit anymore
+     */
+    bool Insert(int width, int height, SDL_Rect& out)
+    {
+        int bestIndex = -1;
+        int bestTop = INT_MAX;
+        int bestWidth = INT_MAX;
+        int bestY = 0;
+        for(size_t i = 0; i < m_skyline.size(); ++i)
+        {
+            int y;
+            if(!Fits(i, width, height, y))
+            {
+                continue;
+            }
+            if(y + height < bestTop || (y + height == bestTop && m_skyline[i].width < bestWidth))
+            {
+                bestIndex = static_cast<int>(i);
+                bestTop = y + height;
+                bestWidth = m_skyline[i].width;
+                bestY = y;
+            }
+        }
+        if(bestIndex < 0)
+        {
+            return false;
+        }
+
+        out = SDL_Rect{m_skyline[bestIndex].x, bestY, width, height};
+        AddSegment(bestIndex, out);
+        m_usedArea += static_cast<long>(width) * height;
+        return true;
+    }
+
+    /**
+     * \brief Fraction of the page covered by rectangles, 0-1
+     */
+    float Occupancy() const
+    {
+        return static_cast<float>(m_usedArea) / (static_cast<float>(m_width) * m_height);
+    }
+
+private:
+    /**
+     * @struct Segment
+     * @brief Horizontal part of the skyline
+     */
+    struct Segment
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    /**
+     * \brief Whether a rectangle fits with its left edge on a segment
+     * @param y lowest y the rectangle can be placed at
+     */
+    bool Fits(size_t index, int width, int height, int& y) const
+    {
+        int x = m_skyline[index].x;
+        if(x + width > m_width)
+        {
+            return false;
+        }
+        y = 0;
+        int remaining = width;
+        for(size_t i = index; remaining > 0; ++i)
+        {
+            if(i == m_skyline.size())
+            {
+                return false;
+            }
+            y = std::max(y, m_skyline[i].y);
+            if(y + height > m_height)
+            {
+                return false;
+            }
+            remaining -= m_skyline[i].width;
+        }
+        return true;
+    }
+
+    /**
+     * \brief Raise the skyline under a placed rectangle
+     */
+    void AddSegment(int index, SDL_Rect const& rect)
+    {
+        m_skyline.insert(m_skyline.begin() + index, Segment{rect.x, rect.y + rect.h, rect.w});
+
+        size_t i = index + 1;
+        while(i < m_skyline.size())
+        {
+            Segment& previous = m_skyline[i - 1];
+            Segment& current = m_skyline[i];
+            int overlap = previous.x + previous.width - current.x;
+            if(overlap <= 0)
+            {
+                break;
+            }
+            current.x += overlap;
+            current.width -= overlap;
+            if(current.width > 0)
+            {
+                break;
+            }
+            m_skyline.erase(m_skyline.begin() + i);
+        }
+
+        for(size_t j = 0; j + 1 < m_skyline.size(); )
+        {
+            if(m_skyline[j].y == m_skyline[j + 1].y)
+            {
+                m_skyline[j].width += m_skyline[j + 1].width;
+                m_skyline.erase(m_skyline.begin() + j + 1);
+            }
+            else
+            {
+                ++j;
+            }
+        }
+    }
+
+    int m_width;///< Width of the page.
+    int m_height;///< Height of the page.
+    long m_usedArea = 0;///< Area covered by rectangles.
+    std::vector<Segment> m_skyline;///< Top edge of the used area, left to right.
+};
+
+/**
+ * @struct AtlasEntry
+ * @brief One image to place in an atlas.
+ */
+struct AtlasEntry
+{
+    int width = 0;///< Width of the image.
+    int height = 0;///< Height of the image.
+    int page = -1;///< Page the image was put on, -1 if it is larger than a page.
+    SDL_Rect rect{0, 0, 0, 0};///< Position of the image in its page.
+};
+
+/**
+ * \brief Place images on as few atlas pages as needed
+ * Images are packed tallest first, which is what the skyline heuristic works best with.
+ * @param entries images to place, their page and rect are filled in
+ * @param pageWidth width of a page
+ * @param pageHeight height of a page
+ * @param padding pixels kept around every image against filtering bleed, see ExtrudeAtlasPadding
+ * @return number of pages used
+ */
+inline int PackAtlas(std::vector<AtlasEntry>& entries, int pageWidth, int pageHeight, int padding = 1)
+{
+    std::vector<size_t> order(entries.size());
+    for(size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&entries](size_t a, size_t b)
+                     {
+                         if(entries[a].height != entries[b].height)
+                         {
+                             return entries[a].height > entries[b].height;
+                         }
+                         return entries[a].width > entries[b].width;
+                     });
+
+    std::vector<SkylinePacker> pages;
+    for(size_t i : order)
+    {
+        AtlasEntry& entry = entries[i];
+        int width = entry.width + 2 * padding;
+        int height = entry.height + 2 * padding;
+        entry.page = -1;
+        if(width > pageWidth || height > pageHeight)
+        {
+            continue;
+        }
+
+        SDL_Rect rect;
+        for(size_t page = 0; page <= pages.size(); ++page)
+        {
+            if(page == pages.size())
+            {
+                pages.push_back(SkylinePacker(pageWidth, pageHeight));
+            }
+            if(pages[page].Insert(width, height, rect))
+            {
+                entry.page = static_cast<int>(page);
+                entry.rect = SDL_Rect{rect.x + padding, rect.y + padding, entry.width, entry.height};
+                break;
+            }
+        }
+    }
+    return static_cast<int>(pages.size());
+}
+
+/**
+ * \brief Fill the padding around an image copied into an atlas page with the texels of its edges
+ * A sprite sampled with filtering or drawn scaled then blends with its own border instead of transparent pixels.
+ * @param page 32 bits per pixel page surface the image was copied into, locked if it needs to be
+ * @param rect position of the image in the page, from PackAtlas
+ * @param padding padding given to PackAtlas
+ */
+inline void ExtrudeAtlasPadding(SDL_Surface* page, SDL_Rect const& rect, int padding)
+{
+    if(padding <= 0 || rect.w <= 0 || rect.h <= 0)
+    {
+        return;
+    }
+    unsigned char* pixels = static_cast<unsigned char*>(page->pixels);
+    for(int y = rect.y; y < rect.y + rect.h; ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(pixels + static_cast<size_t>(y) * page->pitch);
+        std::fill(row + rect.x - padding, row + rect.x, row[rect.x]);
+        std::fill(row + rect.x + rect.w, row + rect.x + rect.w + padding, row[rect.x + rect.w - 1]);
+    }
+    size_t rowBytes = static_cast<size_t>(rect.w + 2 * padding) * sizeof(uint32_t);
+    size_t left = static_cast<size_t>(rect.x - padding) * sizeof(uint32_t);
+    unsigned char const* top = pixels + static_cast<size_t>(rect.y) * page->pitch + left;
+    unsigned char const* bottom = pixels + static_cast<size_t>(rect.y + rect.h - 1) * page->pitch + left;
+    for(int i = 1; i <= padding; ++i)
+    {
+        std::memcpy(pixels + static_cast<size_t>(rect.y - i) * page->pitch + left, top, rowBytes);
+        std::memcpy(pixels + static_cast<size_t>(rect.y + rect.h - 1 + i) * page->pitch + left, bottom, rowBytes);
+    }
+}
+
+#endif /* TextureAtlas_hpp */
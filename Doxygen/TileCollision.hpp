@@ -0,0 +1,151 @@
+#ifndef TileCollision_hpp
+#define TileCollision_hpp
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * @struct TileRect
+ * @brief A rectangle of tiles, in tile units.
+ */
+struct TileRect
+{
+    int col = 0;///< First column.
+    int row = 0;///< First row.
+    int cols = 0;///< Width in tiles.
+    int rows = 0;///< Height in tiles.
+};
+
+/**
+ * \brief Merge the solid tiles of a map into few rectangles
+ * Greedy meshing: each unvisited solid tile starts a rectangle that grows right as far as possible, then down
+ * while the whole span stays solid. The result covers every solid tile exactly once; it is not always the
+ * smallest possible set but it is close for typical level layouts and costs O(tiles).
+ * @param tiles tile types, row by row
+ * @param mapCol columns of the map
+ * @param mapRow rows of the map
+ * @param isSolid returns whether a tile type collides
+ * @return rectangles covering the solid tiles
+ */
+template <typename IsSolid>
+std::vector<TileRect> MergeSolidTiles(std::vector<int> const& tiles, int mapCol, int mapRow, IsSolid isSolid)
+{
+    std::vector<TileRect> rects;
+    std::vector<bool> used(tiles.size(), false);
+    auto available = [&](int col, int row)
+    {
+        int index = row * mapCol + col;
+        return !used[index] && isSolid(tiles[index]);
+    };
+
+    for(int row = 0; row < mapRow; ++row)
+    {
+        for(int col = 0; col < mapCol; ++col)
+        {
+            if(!available(col, row))
+            {
+                continue;
+            }
+
+            int cols = 1;
+            while(col + cols < mapCol && available(col + cols, row))
+            {
+                ++cols;
+            }
+
+            int rows = 1;
+            bool grow = true;
+            while(grow && row + rows < mapRow)
+            {
+                for(int c = col; c < col + cols; ++c)
+                {
+                    if(!available(c, row + rows))
+                    {
+                        grow = false;
+                        break;
+                    }
+                }
+                if(grow)
+                {
+                    ++rows;
+                }
+            }
+
+            for(int r = row; r < row + rows; ++r)
+            {
+                for(int c = col; c < col + cols; ++c)
+                {
+                    used[r * mapCol + c] = true;
+                }
+            }
+
+            TileRect rect;
+            rect.col = col;
+            rect.row = row;
+            rect.cols = cols;
+            rect.rows = rows;
+            rects.push_back(rect);
+            col += cols - 1;
+        }
+    }
+    return rects;
+}
+
+/**
+ * \brief Tiles touched by a rectangle in pixels, partly covered tiles included
+ * @param minX left edge in pixels
+ * @param minY top edge in pixels
+ * @param maxX right edge in pixels
+ * @param maxY bottom edge in pixels
+ * @param tileWidth width of a tile in pixels
+ * @param tileHeight height of a tile in pixels
+ * @param mapCol columns of the map
+ * @param mapRow rows of the map
+ * @return range of tiles clamped to the map, empty if the rectangle misses it
+ */
+inline TileRect TilesInBounds(float minX, float minY, float maxX, float maxY, int tileWidth, int tileHeight,
+                              int mapCol, int mapRow)
+{
+    int firstCol = std::max(0, static_cast<int>(std::floor(minX / tileWidth)));
+    int firstRow = std::max(0, static_cast<int>(std::floor(minY / tileHeight)));
+    int lastCol = std::min(mapCol, static_cast<int>(std::ceil(maxX / tileWidth)));
+    int lastRow = std::min(mapRow, static_cast<int>(std::ceil(maxY / tileHeight)));
+    TileRect range;
+    range.col = firstCol;
+    range.row = firstRow;
+    range.cols = std::max(0, lastCol - firstCol);
+    range.rows = std::max(0, lastRow - firstRow);
+    return range;
+}
+
+/**
+ * \brief Keep the part of merged rectangles inside a range of tiles
+ * Used to give each physics region only the collision of the tiles it can reach.
+ * @param rects rectangles from MergeSolidTiles
+ * @param clip range of tiles to keep
+ * @return the non empty intersections, in the order of rects
+ */
+inline std::vector<TileRect> ClipTileRects(std::vector<TileRect> const& rects, TileRect const& clip)
+{
+    std::vector<TileRect> clipped;
+    for(TileRect const& rect : rects)
+    {
+        int col = std::max(rect.col, clip.col);
+        int row = std::max(rect.row, clip.row);
+        int lastCol = std::min(rect.col + rect.cols, clip.col + clip.cols);
+        int lastRow = std::min(rect.row + rect.rows, clip.row + clip.rows);
+        if(col < lastCol && row < lastRow)
+        {
+            TileRect part;
+            part.col = col;
+            part.row = row;
+            part.cols = lastCol - col;
+            part.rows = lastRow - row;
+            clipped.push_back(part);
+        }
+    }
+    return clipped;
+}
+
+#endif /* TileCollision_hpp */
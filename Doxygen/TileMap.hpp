@@ -13,23 +13,42 @@
 #endif
 
 #include <cstdio>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <fstream>
 #include <ostream>
+#include <algorithm>
 
 #include "Vector2.hpp"
 #include "Component.hpp"
 #include "GameObject.hpp"
 #include "document.h"
 #include "filereadstream.h"
+#include "CookedScene.hpp"
+#include "FramePipeline.hpp"
 
 
 using namespace rapidjson;
 
+/**
+ * @struct TileChunk
+ * @brief a square block of tiles pre-rendered into one texture
+ */
+struct TileChunk
+{
+    SDL_Texture* texture = nullptr;///< baked tiles of the chunk, nullptr until first baked or after eviction
+    bool dirty = true;///< whether the tiles changed since the chunk was baked
+    uint32_t lastDrawn = 0;///< frame the chunk was last drawn in, to evict the least recently used
+};
+
 /**
  * @class TileMap
  * @brief tilemap class
+ * @details The map is split into chunks of kChunkSize x kChunkSize tiles. Each chunk is baked once into a
+ * render-target texture and drawn with a single copy, and only chunks overlapping the viewport are drawn.
+ * Baked textures are capped by a memory budget: past it, the least recently drawn chunks away from the viewport
+ * lose their texture and are baked again if they come back into view.
  */
 class TileMap
 {
@@ -37,12 +56,38 @@ public:
     
     /**
      * \brief constructor
+     * The tile sheet is acquired from the resource manager and released by the destructor.
      * @param renderer current renderer
      * @param scenePath path of the scene.json
      */
     TileMap(SDL_Renderer* renderer, std::string scenePath);
+    /**
+     * \brief constructor of an empty map built in memory, every tile is 0 until set with SetTile
+     * @param renderer current renderer
+     * @param sheet texture of the tile sheet, owned by the caller
+     * @param tileWidth width of each tile
+     * @param tileHeight height of each tile
+     * @param sheetCol columns of the tile sheet
+     * @param sheetRow rows of the tile sheet
+     * @param mapCol columns of tiles
+     * @param mapRow rows of tiles
+     */
+    TileMap(SDL_Renderer* renderer, SDL_Texture* sheet, int tileWidth, int tileHeight,
+            int sheetCol, int sheetRow, int mapCol, int mapRow);
+    /**
+     * \brief constructor from a cooked scene, nothing is parsed
+     * The tiles are copied out of the mapping in one block, so SetTile keeps working on the copy.
+     * The tile sheet is acquired like in the scene constructor.
+     * @param renderer current renderer
+     * @param scene open cooked scene
+     * @param map tile map of the scene
+     */
+    TileMap(SDL_Renderer* renderer, CookedScene const& scene, CookedTileMap const& map);
     ~TileMap();
     
+    static const int kChunkSize = 32;///< tiles along each side of a chunk
+    static const int kChunkKeepMargin = 1;///< chunks around the visible ones that are never evicted
+    
     /**
      * \brief read map csv file
      * @param csvPath path of the tile map csv file
@@ -62,6 +107,110 @@ public:
      */
     SDL_Rect GetRect(int number);
     
+    /**
+     * \brief draw the chunks that overlap the viewport, baking the dirty ones first
+     * Each drawn chunk is stamped with the frame, then TrimChunks keeps the baked textures within the budget.
+     * @param viewport visible part of the map in world pixels
+     */
+    void Render(SDL_Rect const& viewport);
+    
+    /**
+     * \brief set how much texture memory the baked chunks may use
+     * Chunks in view and within kChunkKeepMargin of it are always kept, even past the budget.
+     * @param bytes budget in bytes, 256 MB by default
+     */
+    void SetChunkMemoryBudget(size_t bytes)
+    {
+        m_chunkMemoryBudget = bytes;
+    }
+    
+    /**
+     * \brief number of chunks that have a baked texture
+     */
+    size_t GetBakedChunkCount() const
+    {
+        return m_bakedChunks.size();
+    }
+    
+    /**
+     * \brief rebake every chunk after the renderer lost its textures
+     * Called by the engine on SDL_RENDER_TARGETS_RESET, when the content of render targets is lost, and on
+     * SDL_RENDER_DEVICE_RESET, when the textures themselves are gone and are destroyed here.
+     * @param deviceLost whether the textures must be created again
+     */
+    void OnRenderReset(bool deviceLost)
+    {
+        for(TileChunk& chunk : m_chunks)
+        {
+            chunk.dirty = true;
+            if(deviceLost && chunk.texture)
+            {
+                SDL_DestroyTexture(chunk.texture);
+                chunk.texture = nullptr;
+            }
+        }
+        if(deviceLost)
+        {
+            m_bakedChunks.clear();
+        }
+    }
+    
+    /**
+     * \brief get the type of a tile
+     * @param col column of the tile
+     * @param row row of the tile
+     * @return tile type, -1 outside the map
+     */
+    int GetTile(int col, int row) const
+    {
+        if(col < 0 || row < 0 || col >= m_mapCol || row >= m_mapRow)
+        {
+            return -1;
+        }
+        return m_vTileNumber[row * m_mapCol + col];
+    }
+    
+    /**
+     * \brief change the type of a tile, only its chunk is baked again
+     * Off the render thread of pipelined frames, the edit is deferred through the render thread dispatch and
+     * applied before the frame that made it is drawn; GetTile sees the new tile from then on.
+     * @param col column of the tile
+     * @param row row of the tile
+     * @param number new tile type
+     */
+    void SetTile(int col, int row, int number);
+    
+    /**
+     * \brief get the dispatch that defers tile edits to the render thread, attached by Engine::EnablePipelinedFrames
+     */
+    RenderThreadDispatch& GetRenderThreadDispatch()
+    {
+        return m_renderThreadDispatch;
+    }
+    
+    /**
+     * \brief get the range of chunks that overlap a viewport
+     * @param viewport visible part of the map in world pixels
+     * @param range first column, first row, last column and last row of chunks, inclusive
+     * @return false if no chunk overlaps the viewport
+     */
+    bool GetVisibleChunks(SDL_Rect const& viewport, SDL_Rect& range) const
+    {
+        int chunkWidth = kChunkSize * m_tileWidth;
+        int chunkHeight = kChunkSize * m_tileHeight;
+        int firstCol = std::max(0, viewport.x / chunkWidth);
+        int firstRow = std::max(0, viewport.y / chunkHeight);
+        int lastCol = std::min(m_chunkCol - 1, (viewport.x + viewport.w - 1) / chunkWidth);
+        int lastRow = std::min(m_chunkRow - 1, (viewport.y + viewport.h - 1) / chunkHeight);
+        if(viewport.w <= 0 || viewport.h <= 0 || viewport.x + viewport.w <= 0 || viewport.y + viewport.h <= 0
+           || firstCol > lastCol || firstRow > lastRow)
+        {
+            return false;
+        }
+        range = SDL_Rect{firstCol, firstRow, lastCol, lastRow};
+        return true;
+    }
+    
     std::vector<int> m_vTileNumber;///< All tiles.
     int m_totalNumber;///< number of tiles
     int m_mapCol;///< columns of tiles
@@ -74,8 +223,63 @@ private:
     int m_sheetRow;///< rows of the sprite shtt.
     SDL_Renderer* m_render;///< current renderer.
     SDL_Texture* m_texture;///< tile map texture
+    TextureHandle m_textureHandle;///< tile sheet held while the map exists, invalid when the sheet is owned by the caller
     
+    /**
+     * \brief render the tiles of one chunk into its texture
+     * @param chunkCol column of the chunk
+     * @param chunkRow row of the chunk
+     */
+    void BakeChunk(int chunkCol, int chunkRow);
+    
+    /**
+     * \brief destroy the textures of the least recently drawn chunks until they fit in the memory budget
+     * BakeChunk adds every chunk it gives a texture to m_bakedChunks.
+     * @param visible range of visible chunks from GetVisibleChunks, grown by kChunkKeepMargin for what is kept
+     */
+    void TrimChunks(SDL_Rect const& visible)
+    {
+        size_t chunkBytes = static_cast<size_t>(kChunkSize) * m_tileWidth * kChunkSize * m_tileHeight * 4;
+        size_t maxChunks = chunkBytes > 0 ? m_chunkMemoryBudget / chunkBytes : m_bakedChunks.size();
+        int margin = kChunkKeepMargin;
+        while(m_bakedChunks.size() > maxChunks)
+        {
+            size_t oldest = m_bakedChunks.size();
+            for(size_t i = 0; i < m_bakedChunks.size(); ++i)
+            {
+                int col = m_bakedChunks[i] % m_chunkCol;
+                int row = m_bakedChunks[i] / m_chunkCol;
+                if(col >= visible.x - margin && col <= visible.w + margin
+                   && row >= visible.y - margin && row <= visible.h + margin)
+                {
+                    continue;
+                }
+                if(oldest == m_bakedChunks.size()
+                   || m_chunks[m_bakedChunks[i]].lastDrawn < m_chunks[m_bakedChunks[oldest]].lastDrawn)
+                {
+                    oldest = i;
+                }
+            }
+            if(oldest == m_bakedChunks.size())
+            {
+                break;
+            }
+            TileChunk& chunk = m_chunks[m_bakedChunks[oldest]];
+            SDL_DestroyTexture(chunk.texture);
+            chunk.texture = nullptr;
+            chunk.dirty = true;
+            m_bakedChunks[oldest] = m_bakedChunks.back();
+            m_bakedChunks.pop_back();
+        }
+    }
     
+    std::vector<TileChunk> m_chunks;///< all chunks, row by row
+    int m_chunkCol = 0;///< columns of chunks
+    int m_chunkRow = 0;///< rows of chunks
+    std::vector<int> m_bakedChunks;///< indices of the chunks that have a texture
+    size_t m_chunkMemoryBudget = 256u << 20;///< bytes of baked textures kept before evicting
+    uint32_t m_frame = 0;///< frames rendered, stamped on the chunks drawn
+    RenderThreadDispatch m_renderThreadDispatch;///< sends tile edits made off the render thread to it
 };
 
 
@@ -0,0 +1,343 @@
+#ifndef TransformSync_hpp
+#define TransformSync_hpp
+
+#include <box2d/box2d.h>
+#include <box2d/b2_body.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Vector2.hpp"
+#include "Transform.hpp"
+#include "Profiler.hpp"
+
+/**
+ * @class TransformSync
+ * @brief Keeps transforms and the bodies of the physical world in step without visiting objects that did not move.
+ * @details Positions set by users only mark their transform dirty; the dirty ones are written to their bodies in one
+ * batch before the next step. After the step, the awake bodies are read into a contiguous array of positions that
+ * is then copied to their transforms. Static bodies are never registered. box2d has no list of awake bodies, so the
+ * awake set is found from the one of the last step: a body only wakes in a step by touching or being jointed to an
+ * awake body, and between steps when it is moved or woken through the engine, which calls Wake. Sleeping bodies
+ * away from the awake ones are never visited.
+ * The transforms whose position changed in the last step, plus those that went to sleep in it, are the moving set:
+ * only they need their previous position saved and their render position interpolated.
+ */
+class TransformSync
+{
+public:
+    static const uint32_t kNotSynced = 0xFFFFFFFFu;///< Sync index of a transform without a body.
+
+    /**
+     * \brief Start syncing a transform with a body, a static body does not need it
+     * @param transform transform of the object
+     * @param body body of the object in the world
+     */
+    void Add(Transform* transform, b2Body* body)
+    {
+        if(transform->m_syncIndex != kNotSynced)
+        {
+            m_indexOfBody.erase(m_bodies[transform->m_syncIndex]);
+            m_indexOfBody[body] = transform->m_syncIndex;
+            m_bodies[transform->m_syncIndex] = body;
+            m_woken.push_back(transform->m_syncIndex);
+            return;
+        }
+        uint32_t index;
+        if(!m_freeIndices.empty())
+        {
+            index = m_freeIndices.back();
+            m_freeIndices.pop_back();
+            m_bodies[index] = body;
+            m_transforms[index] = transform;
+        }
+        else
+        {
+            index = static_cast<uint32_t>(m_bodies.size());
+            m_bodies.push_back(body);
+            m_transforms.push_back(transform);
+            m_visitStep.push_back(0);
+        }
+        m_indexOfBody[body] = index;
+        if(body->IsAwake())
+        {
+            m_woken.push_back(index);
+        }
+        transform->m_sync = this;
+        transform->m_syncIndex = index;
+        transform->m_dirty = false;
+        transform->ResetInterpolation();
+    }
+
+    /**
+     * \brief Stop syncing a transform, before its body is destroyed
+     * The slot is left empty and reused by the next Add, so the indices of the other transforms do not change.
+     * @param transform transform of the object
+     */
+    void Remove(Transform* transform)
+    {
+        uint32_t index = transform->m_syncIndex;
+        if(index == kNotSynced)
+        {
+            return;
+        }
+        m_indexOfBody.erase(m_bodies[index]);
+        m_bodies[index] = nullptr;
+        m_transforms[index] = nullptr;
+        m_freeIndices.push_back(index);
+        transform->m_sync = nullptr;
+        transform->m_syncIndex = kNotSynced;
+        transform->m_dirty = false;
+    }
+
+    /**
+     * \brief Point the sync of a transform at its new address, after its storage moved it
+     * Called by ComponentArray when it moves transforms, see OnComponentMoved.
+     * @param transform transform at its new address
+     */
+    static void Relink(Transform* transform)
+    {
+        if(transform->m_sync)
+        {
+            transform->m_sync->m_transforms[transform->m_syncIndex] = transform;
+        }
+    }
+
+    /**
+     * \brief Stop syncing a transform with the sync it is in, if any, before it is destroyed
+     * @param transform transform about to be destroyed
+     */
+    static void Detach(Transform* transform)
+    {
+        if(transform->m_sync)
+        {
+            transform->m_sync->Remove(transform);
+        }
+    }
+
+    /**
+     * \brief Have the body of a transform checked by the next CollectAwake
+     * The engine calls it when it wakes a body outside a step, as applying a force or setting a velocity does.
+     * Safe to call from several threads at once.
+     * @param transform transform of the woken body
+     */
+    static void Wake(Transform* transform)
+    {
+        TransformSync* sync = transform->m_sync;
+        if(sync)
+        {
+            std::lock_guard<std::mutex> lock(sync->m_dirtyMutex);
+            sync->m_woken.push_back(transform->m_syncIndex);
+        }
+    }
+
+    /**
+     * \brief Queue the position of a transform to be written to its body before the next step
+     * The transform is drawn at its new position right away, without interpolating from the old one.
+     * Safe to call from several threads at once.
+     * @param transform transform whose position was set
+     * @return false if the transform has no body to sync
+     */
+    bool MarkDirty(Transform* transform)
+    {
+        transform->ResetInterpolation();
+        uint32_t index = transform->m_syncIndex;
+        if(index == kNotSynced)
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(m_dirtyMutex);
+        if(!transform->m_dirty)
+        {
+            transform->m_dirty = true;
+            m_dirty.push_back(index);
+        }
+        return true;
+    }
+
+    /**
+     * \brief Write the positions of the dirty transforms to their bodies and wake them, before a step
+     * @param scale pixels per meter of the world
+     */
+    void FlushDirty(float scale)
+    {
+        PROFILE_SCOPE("TransformSync::FlushDirty");
+        std::lock_guard<std::mutex> lock(m_dirtyMutex);
+        float inverse = 1.0f / scale;
+        for(uint32_t index : m_dirty)
+        {
+            Transform* transform = m_transforms[index];
+            if(!transform || !transform->m_dirty)
+            {
+                continue;
+            }
+            transform->m_dirty = false;
+            b2Body* body = m_bodies[index];
+            body->SetTransform(b2Vec2(transform->position.x * inverse, transform->position.y * inverse), body->GetAngle());
+            body->SetAwake(true);
+            m_woken.push_back(index);
+        }
+        m_dirty.clear();
+    }
+
+    /**
+     * \brief Remember the position of every moving transform as the state before the next step
+     */
+    void SavePreviousPositions()
+    {
+        for(uint32_t index : m_moving)
+        {
+            if(Transform* transform = m_transforms[index])
+            {
+                transform->SavePreviousPosition();
+            }
+        }
+    }
+
+    /**
+     * \brief Read the positions of the awake bodies after a step and copy them to their transforms
+     * The bodies that fell asleep during the step are read too, once, so their transform has their resting position.
+     * Starts from the bodies awake after the last step and those woken since, and follows the touching contacts and
+     * joints of the awake ones to the bodies the step woke.
+     * @param scale pixels per meter of the world
+     */
+    void CollectAwake(float scale)
+    {
+        PROFILE_SCOPE("TransformSync::CollectAwake");
+        ++m_step;
+        m_frontier.assign(m_awakeIndices.begin(), m_awakeIndices.end());
+        {
+            std::lock_guard<std::mutex> lock(m_dirtyMutex);
+            m_frontier.insert(m_frontier.end(), m_woken.begin(), m_woken.end());
+            m_woken.clear();
+        }
+        m_awakeIndices.clear();
+        m_awakePositions.clear();
+        for(size_t i = 0; i < m_frontier.size(); ++i)
+        {
+            uint32_t index = m_frontier[i];
+            b2Body* body = m_bodies[index];
+            if(!body || m_visitStep[index] == m_step || !body->IsAwake())
+            {
+                continue;
+            }
+            m_visitStep[index] = m_step;
+            b2Vec2 const& position = body->GetPosition();
+            m_awakeIndices.push_back(index);
+            m_awakePositions.push_back(Vector2(position.x * scale, position.y * scale));
+            for(b2ContactEdge* edge = body->GetContactList(); edge; edge = edge->next)
+            {
+                if(edge->contact->IsTouching())
+                {
+                    Visit(edge->other);
+                }
+            }
+            for(b2JointEdge* edge = body->GetJointList(); edge; edge = edge->next)
+            {
+                Visit(edge->other);
+            }
+        }
+        for(size_t i = 0; i < m_awakeIndices.size(); ++i)
+        {
+            Transform* transform = m_transforms[m_awakeIndices[i]];
+            transform->position = m_awakePositions[i];
+            transform->m_awakeStep = m_step;
+        }
+
+        // Bodies that fell asleep in this step stay in the moving set once more, so their interpolation settles.
+        // The step moved them before putting them to sleep, so their final position is read here.
+        m_nextMoving.assign(m_awakeIndices.begin(), m_awakeIndices.end());
+        for(uint32_t index : m_moving)
+        {
+            Transform* transform = m_transforms[index];
+            if(transform && transform->m_awakeStep == m_step - 1)
+            {
+                b2Vec2 const& position = m_bodies[index]->GetPosition();
+                transform->position = Vector2(position.x * scale, position.y * scale);
+                m_nextMoving.push_back(index);
+            }
+        }
+        m_moving.swap(m_nextMoving);
+    }
+
+    /**
+     * \brief Compute the render position of every moving transform
+     * @param alpha how far the current time is between the last two steps, 0-1
+     */
+    void Interpolate(float alpha)
+    {
+        for(uint32_t index : m_moving)
+        {
+            if(Transform* transform = m_transforms[index])
+            {
+                transform->Interpolate(alpha);
+            }
+        }
+    }
+
+    /**
+     * \brief Number of bodies awake after the last step
+     */
+    size_t GetAwakeCount() const
+    {
+        return m_awakeIndices.size();
+    }
+
+    /**
+     * \brief Get the transform of a body awake after the last step
+     * @param i index among the awake bodies, below GetAwakeCount
+     */
+    Transform* GetAwakeTransform(size_t i) const
+    {
+        return m_transforms[m_awakeIndices[i]];
+    }
+
+    /**
+     * \brief Get a body awake after the last step
+     * @param i index among the awake bodies, below GetAwakeCount
+     */
+    b2Body* GetAwakeBody(size_t i) const
+    {
+        return m_bodies[m_awakeIndices[i]];
+    }
+
+    /**
+     * \brief Number of transforms synced with a body
+     */
+    size_t GetSyncedCount() const
+    {
+        return m_bodies.size() - m_freeIndices.size();
+    }
+
+private:
+    /**
+     * \brief Queue a body next to an awake one for CollectAwake, if it is synced and not visited yet
+     */
+    void Visit(b2Body* body)
+    {
+        auto found = m_indexOfBody.find(body);
+        if(found != m_indexOfBody.end() && m_visitStep[found->second] != m_step)
+        {
+            m_frontier.push_back(found->second);
+        }
+    }
+
+    std::vector<b2Body*> m_bodies;///< Body of each sync index, nullptr for a free slot.
+    std::vector<Transform*> m_transforms;///< Transform of each sync index, nullptr for a free slot.
+    std::vector<uint32_t> m_freeIndices;///< Free slots.
+    std::unordered_map<b2Body const*, uint32_t> m_indexOfBody;///< Sync index of each body.
+    std::vector<uint32_t> m_visitStep;///< Last step CollectAwake visited each sync index in.
+    std::vector<uint32_t> m_woken;///< Sync indices of the bodies added or woken since the last step.
+    std::vector<uint32_t> m_frontier;///< Bodies left to visit by CollectAwake, reused between steps.
+    std::vector<uint32_t> m_dirty;///< Sync indices of the transforms set since the last step.
+    std::vector<uint32_t> m_awakeIndices;///< Sync indices of the bodies awake after the last step.
+    std::vector<Vector2> m_awakePositions;///< Positions of the awake bodies, in the order of m_awakeIndices.
+    std::vector<uint32_t> m_moving;///< Sync indices of the moving set.
+    std::vector<uint32_t> m_nextMoving;///< Moving set being built, reused between steps.
+    std::mutex m_dirtyMutex;///< Guards m_dirty, the dirty flags and m_woken.
+    uint32_t m_step = 0;///< Steps collected so far.
+};
+
+#endif /* TransformSync_hpp */
@@ -17,28 +17,50 @@ class Vector2
 {
 public:
     /**
-     *@brief Default constructor of Vector2
+     *@brief Default constructor of Vector2, the zero vector
      */
-    Vector2();
+    constexpr Vector2() : x(0.0f), y(0.0f) {}
     
     /**
      *@brief Constructor of Vector2
      *@param x the first dimension of Vector2
      *@param y the second dimension of Vector2
      */
-    Vector2(float x, float y);
+    constexpr Vector2(float x, float y) : x(x), y(y) {}
     
-    Vector2 operator+(Vector2 const& rhs);
+    constexpr Vector2 operator+(Vector2 const& rhs) const
+    {
+        return Vector2(x + rhs.x, y + rhs.y);
+    }
     
-    Vector2& operator+=(Vector2 const& rhs);
+    Vector2& operator+=(Vector2 const& rhs)
+    {
+        x += rhs.x;
+        y += rhs.y;
+        return *this;
+    }
     
-    Vector2 operator-(Vector2 const& rhs);
+    constexpr Vector2 operator-(Vector2 const& rhs) const
+    {
+        return Vector2(x - rhs.x, y - rhs.y);
+    }
     
-    Vector2& operator-=(Vector2 const& rhs);
+    Vector2& operator-=(Vector2 const& rhs)
+    {
+        x -= rhs.x;
+        y -= rhs.y;
+        return *this;
+    }
     
-    Vector2 operator-();
+    constexpr Vector2 operator-() const
+    {
+        return Vector2(-x, -y);
+    }
     
-    Vector2 operator*(float rhs);
+    constexpr Vector2 operator*(float rhs) const
+    {
+        return Vector2(x * rhs, y * rhs);
+    }
     
     friend std::ostream& operator << (std::ostream & os, const Vector2 & vec)
     {
@@ -48,29 +70,78 @@ public:
     
     /**
      *@brief normalize the vector2
-     *@return a vector with magnitude of 1
+     *@return a vector with magnitude of 1, or the zero vector if this vector is zero
      */
-    Vector2 normalize();
+    Vector2 normalize() const
+    {
+        float length = magnitude();
+        return length > 0.0f ? Vector2(x / length, y / length) : Vector2();
+    }
     
     /**
      *@brief get the length of the vecoer
      *@return the length of the vector
      */
-    float magnitude();
+    float magnitude() const
+    {
+        return sqrtf(x * x + y * y);
+    }
+    
+    /**
+     *@brief get the squared length of the vector, cheaper than magnitude for comparisons
+     *@return the squared length of the vector
+     */
+    constexpr float sqrMagnitude() const
+    {
+        return x * x + y * y;
+    }
+    
+    /**
+     *@brief get the dot product of two vectors
+     *@param a the first vector
+     *@param b the second vector
+     */
+    static constexpr float dot(Vector2 const& a, Vector2 const& b)
+    {
+        return a.x * b.x + a.y * b.y;
+    }
     
     /**
      *@brief get the distance between two points
      *@param a the first point
      *@param b the second point
      */
-    static float distance(Vector2 a, Vector2 b);
+    static float distance(Vector2 const& a, Vector2 const& b)
+    {
+        return (a - b).magnitude();
+    }
+    
+    /**
+     *@brief get the squared distance between two points, cheaper than distance for comparisons
+     *@param a the first point
+     *@param b the second point
+     */
+    static constexpr float sqrDistance(Vector2 const& a, Vector2 const& b)
+    {
+        return (a - b).sqrMagnitude();
+    }
     
     /**
      *@brief get the angle between two vectors, 0-180
      *@param a the first point
      *@param b the second point
      */
-    static float angle(Vector2 a, Vector2 b);
+    static float angle(Vector2 const& a, Vector2 const& b)
+    {
+        float lengths = sqrtf(a.sqrMagnitude() * b.sqrMagnitude());
+        if(lengths <= 0.0f)
+        {
+            return 0.0f;
+        }
+        float cosine = dot(a, b) / lengths;
+        cosine = cosine > 1.0f ? 1.0f : (cosine < -1.0f ? -1.0f : cosine);
+        return acosf(cosine) * 57.29577951308232f;
+    }
     
     float x;///first dimension
     float y;///second dimension
@@ -0,0 +1,270 @@
+/**
+ *@file Vector2Batch.hpp
+ *@brief Batch kernels over structure-of-arrays positions and velocities
+ *@details Every kernel works on separate x and y arrays and uses AVX2 or SSE2 when the compiler targets them
+ *(-mavx2, or any x86-64 build for SSE2), with a scalar loop for the remaining elements and other targets.
+ *Arrays do not need any alignment.
+ */
+#ifndef Vector2Batch_hpp
+#define Vector2Batch_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <math.h>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+#endif
+
+/**
+ *@brief add velocity * dt to every position
+ *@param px x of the positions, updated
+ *@param py y of the positions, updated
+ *@param vx x of the velocities
+ *@param vy y of the velocities
+ *@param dt elapsed time
+ *@param count number of elements
+ */
+inline void IntegratePositions(float* px, float* py, float const* vx, float const* vy, float dt, size_t count)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256 step = _mm256_set1_ps(dt);
+    for(; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_ps(px + i, _mm256_add_ps(_mm256_loadu_ps(px + i), _mm256_mul_ps(_mm256_loadu_ps(vx + i), step)));
+        _mm256_storeu_ps(py + i, _mm256_add_ps(_mm256_loadu_ps(py + i), _mm256_mul_ps(_mm256_loadu_ps(vy + i), step)));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 step = _mm_set1_ps(dt);
+    for(; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(px + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(_mm_loadu_ps(vx + i), step)));
+        _mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(_mm_loadu_ps(vy + i), step)));
+    }
+#endif
+    for(; i < count; ++i)
+    {
+        px[i] += vx[i] * dt;
+        py[i] += vy[i] * dt;
+    }
+}
+
+/**
+ *@brief normalize every vector, zero vectors stay zero
+ *@param x x of the vectors, updated
+ *@param y y of the vectors, updated
+ *@param count number of elements
+ */
+inline void NormalizeBatch(float* x, float* y, size_t count)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256 zero = _mm256_setzero_ps();
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 lengthSquared = _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy));
+        __m256 nonZero = _mm256_cmp_ps(lengthSquared, zero, _CMP_GT_OQ);
+        __m256 length = _mm256_sqrt_ps(lengthSquared);
+        _mm256_storeu_ps(x + i, _mm256_and_ps(_mm256_div_ps(vx, length), nonZero));
+        _mm256_storeu_ps(y + i, _mm256_and_ps(_mm256_div_ps(vy, length), nonZero));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 zero = _mm_setzero_ps();
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 lengthSquared = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy));
+        __m128 nonZero = _mm_cmpgt_ps(lengthSquared, zero);
+        __m128 length = _mm_sqrt_ps(lengthSquared);
+        _mm_storeu_ps(x + i, _mm_and_ps(_mm_div_ps(vx, length), nonZero));
+        _mm_storeu_ps(y + i, _mm_and_ps(_mm_div_ps(vy, length), nonZero));
+    }
+#endif
+    for(; i < count; ++i)
+    {
+        float lengthSquared = x[i] * x[i] + y[i] * y[i];
+        if(lengthSquared > 0.0f)
+        {
+            float length = sqrtf(lengthSquared);
+            x[i] /= length;
+            y[i] /= length;
+        }
+        else
+        {
+            x[i] = 0.0f;
+            y[i] = 0.0f;
+        }
+    }
+}
+
+/**
+ *@brief get the squared distance of every point to a center
+ *@param x x of the points
+ *@param y y of the points
+ *@param centerX x of the center
+ *@param centerY y of the center
+ *@param out squared distances
+ *@param count number of elements
+ */
+inline void DistanceSquaredBatch(float const* x, float const* y, float centerX, float centerY, float* out, size_t count)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256 cx = _mm256_set1_ps(centerX);
+    __m256 cy = _mm256_set1_ps(centerY);
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), cx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), cy);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 cx = _mm_set1_ps(centerX);
+    __m128 cy = _mm_set1_ps(centerY);
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), cx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), cy);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+    }
+#endif
+    for(; i < count; ++i)
+    {
+        float dx = x[i] - centerX;
+        float dy = y[i] - centerY;
+        out[i] = dx * dx + dy * dy;
+    }
+}
+
+/**
+ *@brief find the points within a radius of a center
+ *@param x x of the points
+ *@param y y of the points
+ *@param count number of elements
+ *@param centerX x of the center
+ *@param centerY y of the center
+ *@param radius radius of the circle
+ *@param out indices of the points inside, must hold count entries
+ *@return number of indices written
+ */
+inline size_t RadiusQueryBatch(float const* x, float const* y, size_t count,
+                               float centerX, float centerY, float radius, uint32_t* out)
+{
+    float radiusSquared = radius * radius;
+    size_t found = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256 cx = _mm256_set1_ps(centerX);
+    __m256 cy = _mm256_set1_ps(centerY);
+    __m256 r2 = _mm256_set1_ps(radiusSquared);
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), cx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), cy);
+        __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(d2, r2, _CMP_LE_OQ));
+        for(int lane = 0; mask != 0; ++lane, mask >>= 1)
+        {
+            if(mask & 1)
+            {
+                out[found++] = static_cast<uint32_t>(i + lane);
+            }
+        }
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 cx = _mm_set1_ps(centerX);
+    __m128 cy = _mm_set1_ps(centerY);
+    __m128 r2 = _mm_set1_ps(radiusSquared);
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), cx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), cy);
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        int mask = _mm_movemask_ps(_mm_cmple_ps(d2, r2));
+        for(int lane = 0; lane < 4; ++lane)
+        {
+            if(mask & (1 << lane))
+            {
+                out[found++] = static_cast<uint32_t>(i + lane);
+            }
+        }
+    }
+#endif
+    for(; i < count; ++i)
+    {
+        float dx = x[i] - centerX;
+        float dy = y[i] - centerY;
+        if(dx * dx + dy * dy <= radiusSquared)
+        {
+            out[found++] = static_cast<uint32_t>(i);
+        }
+    }
+    return found;
+}
+
+/**
+ *@brief test every box against one box, edges touching count as overlapping
+ *@param minX left edges of the boxes
+ *@param minY top edges of the boxes
+ *@param maxX right edges of the boxes
+ *@param maxY bottom edges of the boxes
+ *@param count number of boxes
+ *@param boxMinX left edge of the tested box
+ *@param boxMinY top edge of the tested box
+ *@param boxMaxX right edge of the tested box
+ *@param boxMaxY bottom edge of the tested box
+ *@param out 1 for the boxes that overlap, 0 for the others
+ */
+inline void OverlapAabbBatch(float const* minX, float const* minY, float const* maxX, float const* maxY, size_t count,
+                             float boxMinX, float boxMinY, float boxMaxX, float boxMaxY, uint8_t* out)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256 bMinX = _mm256_set1_ps(boxMinX);
+    __m256 bMinY = _mm256_set1_ps(boxMinY);
+    __m256 bMaxX = _mm256_set1_ps(boxMaxX);
+    __m256 bMaxY = _mm256_set1_ps(boxMaxY);
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 overlap = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(minX + i), bMaxX, _CMP_LE_OQ),
+                          _mm256_cmp_ps(_mm256_loadu_ps(maxX + i), bMinX, _CMP_GE_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(minY + i), bMaxY, _CMP_LE_OQ),
+                          _mm256_cmp_ps(_mm256_loadu_ps(maxY + i), bMinY, _CMP_GE_OQ)));
+        int mask = _mm256_movemask_ps(overlap);
+        for(int lane = 0; lane < 8; ++lane)
+        {
+            out[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 bMinX = _mm_set1_ps(boxMinX);
+    __m128 bMinY = _mm_set1_ps(boxMinY);
+    __m128 bMaxX = _mm_set1_ps(boxMaxX);
+    __m128 bMaxY = _mm_set1_ps(boxMaxY);
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 overlap = _mm_and_ps(
+            _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(minX + i), bMaxX), _mm_cmpge_ps(_mm_loadu_ps(maxX + i), bMinX)),
+            _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(minY + i), bMaxY), _mm_cmpge_ps(_mm_loadu_ps(maxY + i), bMinY)));
+        int mask = _mm_movemask_ps(overlap);
+        for(int lane = 0; lane < 4; ++lane)
+        {
+            out[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+    }
+#endif
+    for(; i < count; ++i)
+    {
+        out[i] = static_cast<uint8_t>(minX[i] <= boxMaxX && maxX[i] >= boxMinX
+                                      && minY[i] <= boxMaxY && maxY[i] >= boxMinY);
+    }
+}
+
+#endif /* Vector2Batch_hpp */